@@ -0,0 +1,1847 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Host benchmark suite, built by [env:native] and linked against src/main.cpp and the fake Arduino layer.
+//Run with: pio run -e native && .pio/build/native/program [messages]
+
+#include <Arduino.h>
+#include <HostArduino.h>
+#include <SegmentOutput.h>
+#include <CommandParser.h>
+#include <DisplayDriver.h>
+#include <NetworkServer.h>
+#include <UdpListener.h>
+#include <WiFiTransport.h>
+#include <ClockSync.h>
+#include <TaskScheduler.h>
+#include <Metrics.h>
+#include <BinaryFrame.h>
+#include <SegmentFont.h>
+#include <WebSocketPush.h>
+#include <DisplayState.h>
+#include <ConfigStore.h>
+#include <SerialSource.h>
+#include <EEPROM.h>
+#include <FS.h>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <map>
+#include <regex>
+#include <string>
+#include <new>
+
+//Segment chain wiring, must match the GPIO declarations in src/main.cpp
+#define BENCH_SEGMENT_DATA D1
+#define BENCH_SEGMENT_CLOCK D2
+#define BENCH_SEGMENT_LATCH D3
+#define BENCH_NUM_DIGITS 4
+#define BENCH_SERVER_PORT 23
+#define BENCH_UART_BAUD 74880
+//Give up on a message if it is not latched after this many loop() iterations
+#define BENCH_MAX_LOOPS_PER_MESSAGE 1000
+//Simulated time between messages from one client, the timing system streams at 100 Hz
+#define BENCH_MESSAGE_INTERVAL 10
+#define BENCH_BURST_INTERVAL 100
+#define BENCH_FAIR_CLIENTS 3 //Well behaved clients next to one flooding client
+#define BENCH_FLOOD_BACKLOG 256 //Bytes the flooding client keeps waiting in its socket
+#define BENCH_BURST_CLIENTS 4
+#define BENCH_BURST_MESSAGES 20
+#define BENCH_PARSE_ROUNDS 200
+#define BENCH_COALESCE_BURST 12 //Numbers per burst, must fit in one client receive buffer
+#define BENCH_FUZZ_MAX_LENGTH 31
+#define BENCH_UDP_GROUP 1         //Display group from the default config
+#define BENCH_UDP_FIRST_SEQUENCE 65500 //Close to the wrap around
+#define BENCH_STOPWATCH_RUN 5000        //ms, in 1 ms loop() steps
+#define BENCH_STOPWATCH_ROLLOVER 2000   //ms after the start that micros() rolls over
+#define BENCH_STOPWATCH_OFFSET 50       //Hundredths the stopwatch is started at
+#define BENCH_HOST_CLOCK_OFFSET 123456789UL //Host clock minus micros(), what clock sync has to find
+#define BENCH_JITTER_MAX 20             //ms, one way network delay is 1 ms up to this, independently per direction
+#define BENCH_SCHEDULE_AHEAD 200000     //us, how far ahead the host schedules a latch
+#define BENCH_TASK_RUN 10000            //ms, in 1 ms loop() steps
+#define BENCH_TASK_ROLLOVER 5000        //ms after the start that micros() rolls over
+#define BENCH_TASK_PERIOD 5             //ms, periodic task of the stand-alone scheduler
+#define BENCH_TASK_CHAIN_DELAY 3        //ms, task which schedules its own next run
+#define BENCH_TASK_STALL 52             //ms loop() doesn't run
+#define BENCH_TASK_COUNTDOWN 5          //s
+#define BENCH_METRICS_SAMPLES 1000000
+#define BENCH_BOOT_COUNTDOWN 45         //s left on the countdown that was running before the reset
+#define BENCH_WIFI_CONNECT 4000         //ms from reset until the stored network is connected
+#define BENCH_CONFIG_JSON "{\"ip\":\"192.168.1.23\",\"gateway\":\"192.168.1.1-and-far-too-long\",\"subnet\":\"255.255.255.0\",\"group\":\"1\"}"
+#define BENCH_CONFIG_LOADS 1000
+#define BENCH_SERIAL_BURST 40 //Lines sent on the serial port at once
+#define BENCH_PERSIST_WAIT 70000 //ms a shown value stays, longer than the stable time and the minimum interval
+#define BENCH_PUSH_RUN 1000             //ms of 100 Hz updates while a browser is connected
+#define BENCH_PUSH_INTERVAL 50          //ms, WEBSOCKET_PUSH_INTERVAL in src/main.cpp
+
+#ifndef COALESCE_NUMBERS
+#define COALESCE_NUMBERS 0
+#endif
+//Skipped number updates, counted in src/main.cpp
+extern unsigned long ulDroppedNumberUpdates;
+extern UdpListener<WiFiTransport> UpdateListener;
+extern ClockSync HostClock;
+extern TaskScheduler Tasks;
+extern bool bBootDone;
+extern uint32_t ulBootRestoredMicros;
+extern uint32_t ulBootSetupMicros;
+extern unsigned long ulBootWifiMillis;
+extern DisplayConfig Config;
+extern ConfigStore Store;
+extern SerialSource SerialCommands;
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+#ifndef WEBSOCKET_PORT
+#define WEBSOCKET_PORT 81
+#endif
+#if HTTP_PORT && WEBSOCKET_PORT
+extern WebSocketPush<WiFiTransport> DisplayPush;
+#endif
+
+/**************************** Heap allocation counting ****************************/
+//Only allocations made from inside loop() are counted, the harness' own containers are not
+static bool bCountAllocations = false;
+static unsigned long ulHeapAllocations = 0;
+
+void *operator new(size_t size)
+{
+   if (bCountAllocations)
+   {
+      ulHeapAllocations++;
+   }
+   void *p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void *operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+//Kept out of line, inlined into a caller the compiler would see free() on memory from operator new
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+   free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+   operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+   operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+   operator delete(p);
+}
+
+/**************************** Helpers ****************************/
+typedef std::chrono::steady_clock BenchClock;
+
+//Set by any failed check, main() then returns non-zero so scripts can tell
+static bool bBenchFailed = false;
+
+//Returns the text for the outcome of a check
+static const char *Outcome(bool bPassed, const char *szPassed, const char *szFailed)
+{
+   bBenchFailed |= !bPassed;
+   return bPassed ? szPassed : szFailed;
+}
+
+//Passes a count of things that went wrong through, anything but 0 fails the run
+static unsigned long Failures(unsigned long ulCount)
+{
+   bBenchFailed |= ulCount != 0;
+   return ulCount;
+}
+
+static double ElapsedMicros(BenchClock::time_point Start)
+{
+   return std::chrono::duration<double, std::micro>(BenchClock::now() - Start).count();
+}
+
+static double Percentile(std::vector<double> Samples, double Fraction)
+{
+   if (Samples.empty())
+   {
+      return 0;
+   }
+   std::sort(Samples.begin(), Samples.end());
+   size_t Index = (size_t)(Fraction * (Samples.size() - 1) + 0.5);
+   return Samples[Index];
+}
+
+static double Mean(const std::vector<double> &Samples)
+{
+   double Sum = 0;
+   for (double Sample : Samples)
+   {
+      Sum += Sample;
+   }
+   return Samples.empty() ? 0 : Sum / Samples.size();
+}
+
+//Runs loop() once and returns how long it took
+static double TimedLoop()
+{
+   auto Start = BenchClock::now();
+   bCountAllocations = true;
+   loop();
+   bCountAllocations = false;
+   return ElapsedMicros(Start);
+}
+
+//The frame the display latches for a number
+static std::vector<uint8_t> NumberFrame(long lValue, uint8_t iNumDecimals)
+{
+   DisplayDriver Expected;
+   Expected.SetNumber(lValue, iNumDecimals);
+   return std::vector<uint8_t>(Expected.GetFrame(), Expected.GetFrame() + BENCH_NUM_DIGITS);
+}
+
+/**************************** Benchmarks ****************************/
+//Loop iterations per second with no client traffic
+static double BenchIdleLoop()
+{
+   unsigned long ulIterations = 0;
+   auto Start = BenchClock::now();
+   while (ElapsedMicros(Start) < 1000000)
+   {
+      loop();
+      ulIterations++;
+   }
+   double dMicrosPerLoop = ElapsedMicros(Start) / ulIterations;
+   printf("idle loop:       %lu iterations/s (%.2f us/iteration)\r\n", ulIterations, dMicrosPerLoop);
+   return dMicrosPerLoop;
+}
+
+//Time from a client sending a number to the segment bytes being latched
+static void BenchMessageLatency(unsigned long ulMessages)
+{
+   const char *Messages[] = {"1234\n", "4321\n"};
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   std::vector<double> Latencies, LoopCpu, LoopsPerMessage;
+   unsigned long ulFailed = 0, ulMissingAcks = 0;
+   unsigned long ulAllocationsStart = ulHeapAllocations;
+   unsigned long ulUartStart = HostArduino::SerialBytesWritten();
+   unsigned long ulShiftedStart = Chain.ulBytesShifted;
+   for (unsigned long i = 0; i < ulMessages; i++)
+   {
+      unsigned long ulLatchCount = Chain.ulLatchCount;
+      double dCpu = 0;
+      int iLoops = 0;
+      HostArduino::AdvanceClock(BENCH_MESSAGE_INTERVAL);
+      auto Start = BenchClock::now();
+      Client.Send(Messages[i % 2]);
+      while (Chain.ulLatchCount == ulLatchCount && iLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+      {
+         dCpu += TimedLoop();
+         iLoops++;
+      }
+      double dLatency = ElapsedMicros(Start);
+      if (Chain.ulLatchCount == ulLatchCount)
+      {
+         ulFailed++;
+         continue;
+      }
+      Latencies.push_back(dLatency);
+      LoopCpu.push_back(dCpu);
+      LoopsPerMessage.push_back(iLoops);
+
+      uint8_t Ack = 0;
+      if (Client.Receive(&Ack, 1) != 1 || Ack != 0x06)
+      {
+         ulMissingAcks++;
+      }
+   }
+   Client.Close();
+
+   double dMessages = ulMessages - ulFailed;
+   double dUartBytes = (HostArduino::SerialBytesWritten() - ulUartStart) / dMessages;
+   //Receiving, queueing and latching a message must not touch the heap
+   unsigned long ulAllocations = Failures(ulHeapAllocations - ulAllocationsStart);
+   printf("message latency: p50 %.2f us | p99 %.2f us | max %.2f us (%.0f messages, %.1f loops/message)\r\n",
+          Percentile(Latencies, 0.5), Percentile(Latencies, 0.99), Percentile(Latencies, 1.0), dMessages, Mean(LoopsPerMessage));
+   printf("message cost:    %.2f us loop CPU | %.1f heap allocations | %.1f bytes shifted | %.0f UART bytes (~%.1f ms at %d baud)\r\n",
+          Mean(LoopCpu), ulAllocations / dMessages, (Chain.ulBytesShifted - ulShiftedStart) / dMessages,
+          dUartBytes, dUartBytes * 10 * 1000 / BENCH_UART_BAUD, BENCH_UART_BAUD);
+   if (ulFailed > 0 || ulMissingAcks > 0)
+   {
+      bBenchFailed = true;
+      printf("errors:          %lu messages never latched, %lu missing ACKs\r\n", ulFailed, ulMissingAcks);
+   }
+}
+
+//Shift register traffic when a client keeps sending the value that is already shown
+static void BenchRepeatedValue(unsigned long ulMessages)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   Client.Send("1234\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   unsigned long ulShiftedStart = Chain.ulBytesShifted;
+   unsigned long ulLatchesStart = Chain.ulLatchCount;
+   unsigned long ulAcks = 0;
+   for (unsigned long i = 0; i < ulMessages; i++)
+   {
+      HostArduino::AdvanceClock(BENCH_MESSAGE_INTERVAL);
+      Client.Send("1234\n");
+      uint8_t Ack = 0;
+      for (int j = 0; j < BENCH_MAX_LOOPS_PER_MESSAGE && Client.Receive(&Ack, 1) == 0; j++)
+      {
+         loop();
+      }
+      ulAcks += Ack == 0x06;
+   }
+   Client.Close();
+
+   //The value already shown must not be shifted or latched again, but every message is still confirmed
+   unsigned long ulShifted = Failures(Chain.ulBytesShifted - ulShiftedStart);
+   unsigned long ulLatches = Failures(Chain.ulLatchCount - ulLatchesStart);
+   bBenchFailed |= ulAcks != ulMessages;
+   printf("repeated value:  %.2f bytes shifted | %.2f latches per message (%lu of %lu messages ACKed)\r\n", (double)ulShifted / ulMessages,
+          (double)ulLatches / ulMessages, ulAcks, ulMessages);
+}
+
+//Loop time while several clients each send a burst of messages at once, like a timing system does.
+//The numbers must be shown in the order they arrived in, across all clients.
+static void BenchClientBursts(unsigned long ulBursts)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   HostArduino::FakeClient Clients[BENCH_BURST_CLIENTS];
+   for (auto &Client : Clients)
+   {
+      Client = HostArduino::Connect(BENCH_SERVER_PORT);
+      loop();
+   }
+
+   std::vector<double> LoopTimes;
+   unsigned long ulExpected = 0, ulLatched = 0, ulReadCalls = 0, ulOutOfOrder = 0;
+   for (unsigned long b = 0; b < ulBursts; b++)
+   {
+      HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+      HostArduino::RecordReads(true);
+      HostArduino::RecordLatches(true);
+      unsigned long ulLatchCount = Chain.ulLatchCount;
+      unsigned long ulReadCallsStart = 0;
+      for (int c = 0; c < BENCH_BURST_CLIENTS; c++)
+      {
+         char szBurst[BENCH_BURST_MESSAGES * 6 + 1] = "";
+         for (int m = 0; m < BENCH_BURST_MESSAGES; m++)
+         {
+            //Alternate values so each message changes the display
+            snprintf(szBurst + strlen(szBurst), 7, "%i\n", 1000 + c * 100 + m * 2 + (int)(b % 2));
+         }
+         Clients[c].Send(szBurst);
+         ulReadCallsStart += Clients[c].GetConnection().ulReadCalls;
+      }
+      ulExpected += BENCH_BURST_CLIENTS * BENCH_BURST_MESSAGES;
+
+      //Run until every message was shown (or skipped by coalescing), or the display stops making progress
+      unsigned long ulDroppedStart = ulDroppedNumberUpdates;
+      auto Handled = [&]() { return Chain.ulLatchCount - ulLatchCount + ulDroppedNumberUpdates - ulDroppedStart; };
+      int iIdleLoops = 0;
+      while (Handled() < BENCH_BURST_CLIENTS * BENCH_BURST_MESSAGES && iIdleLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+      {
+         unsigned long ulHandledBefore = Handled();
+         LoopTimes.push_back(TimedLoop());
+         iIdleLoops = Handled() == ulHandledBefore ? iIdleLoops + 1 : 0;
+      }
+      ulLatched += Handled();
+
+      //Arrival order is the order the display read the newlines in. What was shown must follow it, with coalescing
+      //some numbers are skipped but never reordered.
+      std::map<const HostArduino::Connection *, std::string> Partial;
+      std::vector<int> Arrived;
+      for (auto &Read : HostArduino::GetReadLog())
+      {
+         if (Read.Data == '\n')
+         {
+            Arrived.push_back(atoi(Partial[Read.Conn].c_str()));
+            Partial[Read.Conn].clear();
+         }
+         else
+         {
+            Partial[Read.Conn] += (char)Read.Data;
+         }
+      }
+      size_t Next = 0;
+      for (auto &Frame : Chain.LatchHistory)
+      {
+         while (Next < Arrived.size() && NumberFrame(Arrived[Next], 2) != Frame)
+         {
+            Next++;
+         }
+         ulOutOfOrder += Next == Arrived.size();
+         Next++;
+      }
+      ulOutOfOrder += Arrived.empty() || Chain.Latched != NumberFrame(Arrived.back(), 2);
+      HostArduino::RecordReads(false);
+      HostArduino::RecordLatches(false);
+
+      for (auto &Client : Clients)
+      {
+         ulReadCalls += Client.GetConnection().ulReadCalls;
+         uint8_t Acks[BENCH_BURST_MESSAGES];
+         while (Client.Receive(Acks, sizeof(Acks)) > 0)
+         {
+         }
+      }
+      ulReadCalls -= ulReadCallsStart;
+   }
+   for (auto &Client : Clients)
+   {
+      Client.Close();
+   }
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   printf("client bursts:   %i clients x %i messages: mean loop %.2f us | p99 %.2f us | max %.2f us | %.1f loops/burst | %.2f read() calls/message\r\n",
+          BENCH_BURST_CLIENTS, BENCH_BURST_MESSAGES, Mean(LoopTimes), Percentile(LoopTimes, 0.99), Percentile(LoopTimes, 1.0),
+          (double)LoopTimes.size() / ulBursts, (double)ulReadCalls / ulExpected);
+   if (ulLatched < ulExpected || ulOutOfOrder > 0)
+   {
+      bBenchFailed = true;
+      printf("errors:          %lu of %lu burst messages never shown, %lu shown out of arrival order\r\n", ulExpected - ulLatched,
+             ulExpected, ulOutOfOrder);
+   }
+}
+
+//Well behaved clients streaming at 100 Hz must keep getting through while one client floods the display,
+//and a new connection may only take the slot of an idle client
+static void BenchFairness(unsigned long ulSeconds)
+{
+   HostArduino::FakeClient Clients[BENCH_FAIR_CLIENTS];
+   std::deque<unsigned long> SendTimes[BENCH_FAIR_CLIENTS];
+   for (auto &Client : Clients)
+   {
+      Client = HostArduino::Connect(BENCH_SERVER_PORT);
+      loop();
+   }
+   auto Flooder = HostArduino::Connect(BENCH_SERVER_PORT);
+   loop();
+
+   //One tick is one loop() and one simulated millisecond
+   unsigned long ulTick = 0, ulFloodSent = 0, ulFloodAcked = 0, ulSent = 0;
+   std::vector<double> AckTimes;
+   auto Run = [&](unsigned long ulTicks, int iQuietClient) {
+      for (unsigned long t = 0; t < ulTicks; t++, ulTick++)
+      {
+         for (int c = 0; c < BENCH_FAIR_CLIENTS; c++)
+         {
+            if (c != iQuietClient && (ulTick + c * 3) % BENCH_MESSAGE_INTERVAL == 0)
+            {
+               char szMessage[8];
+               snprintf(szMessage, sizeof(szMessage), "%i\n", (int)(ulTick % 10000));
+               Clients[c].Send(szMessage);
+               SendTimes[c].push_back(ulTick);
+               ulSent++;
+            }
+         }
+         while (Flooder.IsOpen() && Flooder.GetConnection().RxData.size() < BENCH_FLOOD_BACKLOG)
+         {
+            Flooder.Send("9999\n");
+            ulFloodSent += 5;
+         }
+
+         HostArduino::AdvanceClock(1);
+         loop();
+
+         uint8_t Acks[BENCH_FLOOD_BACKLOG];
+         for (int c = 0; c < BENCH_FAIR_CLIENTS; c++)
+         {
+            size_t Received = Clients[c].Receive(Acks, sizeof(Acks));
+            for (size_t a = 0; a < Received && !SendTimes[c].empty(); a++)
+            {
+               AckTimes.push_back(ulTick + 1 - SendTimes[c].front());
+               SendTimes[c].pop_front();
+            }
+         }
+         ulFloodAcked += Flooder.Receive(Acks, sizeof(Acks));
+      }
+   };
+
+   //Let the flooder's burst allowance run out before measuring
+   Run(1000, -1);
+   AckTimes.clear();
+   ulSent = 0;
+   ulFloodSent = ulFloodAcked = 0;
+   unsigned long ulBacklogStart = Flooder.GetConnection().RxData.size();
+   Run(ulSeconds * 1000, -1);
+   unsigned long ulFloodRead = ulFloodSent + ulBacklogStart - Flooder.GetConnection().RxData.size();
+   unsigned long ulUnacked = ulSent - AckTimes.size();
+
+   printf("fairness:        %i clients at 100 Hz + 1 flooder: ACK after p50 %.0f ms | p99 %.0f ms | max %.0f ms | %lu unACKed | flooder read %lu B/s (limit %i B/s, %lu ACKs)\r\n",
+          BENCH_FAIR_CLIENTS, Percentile(AckTimes, 0.5), Percentile(AckTimes, 0.99), Percentile(AckTimes, 1.0), Failures(ulUnacked),
+          ulFloodRead / ulSeconds, CLIENT_RATE_LIMIT, ulFloodAcked);
+
+   //Every slot is busy with an active client, a newcomer must be refused
+   auto Newcomer = HostArduino::Connect(BENCH_SERVER_PORT);
+   Run(10, -1);
+   bool bRefused = !Newcomer.IsOpen() && Flooder.IsOpen();
+   for (auto &Client : Clients)
+   {
+      bRefused = bRefused && Client.IsOpen();
+   }
+   //Once a client has been quiet long enough, it is the one making room
+   Run(CLIENT_IDLE_TIME + 100, 0);
+   Newcomer = HostArduino::Connect(BENCH_SERVER_PORT);
+   Run(10, 0);
+   bool bIdleEvicted = Newcomer.IsOpen() && !Clients[0].IsOpen() && Clients[1].IsOpen() && Clients[2].IsOpen() && Flooder.IsOpen();
+   printf("eviction:        newcomer with all clients active %s | newcomer with one idle client %s\r\n",
+          Outcome(bRefused, "refused", "NOT REFUSED"), Outcome(bIdleEvicted, "took the idle slot", "DID NOT TAKE THE IDLE SLOT"));
+
+   for (auto &Client : Clients)
+   {
+      Client.Close();
+   }
+   Flooder.Close();
+   Newcomer.Close();
+   //The display still reads what the flooder left in its socket, let that pass before the next scenario
+   for (int i = 0; i < 10 || !Flooder.GetConnection().RxData.empty(); i++)
+   {
+      HostArduino::AdvanceClock(BENCH_MESSAGE_INTERVAL);
+      loop();
+   }
+}
+
+//A client in sequenced mode pipelines messages and must get a numbered ACK or NAK for each, in order
+static void BenchSequencedReplies(unsigned long ulRounds)
+{
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   Client.Send("SEQ\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   uint8_t SwitchReply[3] = {0};
+   unsigned long ulMismatches = Client.Receive(SwitchReply, sizeof(SwitchReply)) != 3 || memcmp(SwitchReply, "\x06" "0\n", 3) != 0;
+
+   //ENQ answers are told apart by their first byte, the other frames must match exactly
+   std::string strExpected;
+   char szRound[64];
+   unsigned long ulEnqAnswers = 0;
+   uint16_t iSequence = 0;
+   std::vector<double> Latencies;
+   for (unsigned long r = 0; r < ulRounds; r++)
+   {
+      HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+      snprintf(szRound, sizeof(szRound), "%i\n12ab\n\x05" "CD%i\n", (int)(r % 10000), (int)(r % 100));
+      strExpected.clear();
+      for (int m = 0; m < 3; m++)
+      {
+         char szFrame[8];
+         snprintf(szFrame, sizeof(szFrame), "%c%u\n", m == 1 ? 0x15 : 0x06, ++iSequence);
+         strExpected += szFrame;
+      }
+
+      auto Start = BenchClock::now();
+      Client.Send(szRound);
+      std::string strReplies;
+      for (int i = 0; i < BENCH_MAX_LOOPS_PER_MESSAGE && strReplies.size() < strExpected.size(); i++)
+      {
+         loop();
+         uint8_t Buffer[64];
+         size_t Received = Client.Receive(Buffer, sizeof(Buffer));
+         for (size_t b = 0; b < Received; b++)
+         {
+            //Drop ENQ answers, up to and including their newline
+            if (Buffer[b] == 0x05)
+            {
+               ulEnqAnswers++;
+               while (b < Received && Buffer[b] != '\n')
+               {
+                  b++;
+               }
+               continue;
+            }
+            strReplies += (char)Buffer[b];
+         }
+      }
+      Latencies.push_back(ElapsedMicros(Start));
+      ulMismatches += strReplies != strExpected;
+   }
+
+   //A line too long for the queue must be NAKed, not cut down to a valid command, on both kinds of connection
+   auto &Chain = HostArduino::GetShiftRegister();
+   std::string strLongClear = "CLR" + std::string(36, ' ') + "\n";
+   HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+   HostArduino::RecordLatches(true);
+   Client.Send("1234\n");
+   Client.Send(strLongClear.c_str());
+   auto Plain = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   Plain.Send(strLongClear.c_str());
+   Plain.Send("4321\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   char szLongReplies[16];
+   snprintf(szLongReplies, sizeof(szLongReplies), "\x06%u\n\x15%u\n", iSequence + 1, iSequence + 2);
+   uint8_t SequencedReplies[32], PlainReplies[8];
+   size_t SequencedLength = Client.Receive(SequencedReplies, sizeof(SequencedReplies));
+   size_t PlainLength = Plain.Receive(PlainReplies, sizeof(PlainReplies));
+   bool bLongRejected = std::string((char *)SequencedReplies, SequencedLength) == szLongReplies && PlainLength == 2 && PlainReplies[0] == 0x15 &&
+                        PlainReplies[1] == 0x06 && Chain.Latched == NumberFrame(4321, 2);
+   for (auto &Frame : Chain.LatchHistory)
+   {
+      //Only the numbers may show, never a cleared display
+      bLongRejected &= Frame == NumberFrame(1234, 2) || Frame == NumberFrame(4321, 2);
+   }
+   HostArduino::RecordLatches(false);
+
+   Plain.Close();
+   Client.Close();
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   bBenchFailed |= ulEnqAnswers != ulRounds;
+   printf("sequenced mode:  %lu pipelined rounds (number, garbage, ENQ, countdown): %lu wrong replies, %lu of %lu ENQs answered, round p50 %.2f us | over-long line %s\r\n",
+          ulRounds, Failures(ulMismatches), ulEnqAnswers, ulRounds, Percentile(Latencies, 0.5),
+          Outcome(bLongRejected, "rejected", "NOT REJECTED"));
+}
+
+//Text and binary messages mixed on one connection. Every frame carries an ENQ byte in its value,
+//which must not be answered, and is followed by a frame with a broken checksum, which must be NAKed.
+static void BenchBinaryFrames(unsigned long ulRounds)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   std::vector<double> Latencies;
+   unsigned long ulWrongValue = 0, ulWrongReplies = 0;
+   unsigned long ulLatchStart = Chain.ulLatchCount;
+   for (unsigned long r = 0; r < ulRounds; r++)
+   {
+      long lValue = 0x0500 + (long)(r % 256);
+      uint8_t Body[] = {BINARY_OP_SET_NUMBER, (uint8_t)(lValue >> 8), (uint8_t)lValue, 0, BINARY_OP_SEGMENTS, 0, 1, SEG_G};
+      uint8_t Data[64];
+      size_t Length = sprintf((char *)Data, "%i\n", (int)(r % 1000));
+      Length += BuildBinaryFrame(Body, sizeof(Body), Data + Length);
+      Length += BuildBinaryFrame(Body, sizeof(Body), Data + Length);
+      Data[Length - 1]++;
+
+      DisplayDriver Expected;
+      Expected.SetNumber(lValue, 0);
+      Expected.SetSegments(0, DisplayWiring::Map(SEG_G));
+      std::vector<uint8_t> ExpectedFrame(Expected.GetFrame(), Expected.GetFrame() + BENCH_NUM_DIGITS);
+
+      HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+      auto Start = BenchClock::now();
+      Client.Send(Data, Length);
+      int iLoops = 0;
+      while (Chain.Latched != ExpectedFrame && iLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+      {
+         loop();
+         iLoops++;
+      }
+      if (Chain.Latched != ExpectedFrame)
+      {
+         ulWrongValue++;
+      }
+      Latencies.push_back(ElapsedMicros(Start));
+
+      uint8_t Replies[8];
+      ulWrongReplies += Client.Receive(Replies, sizeof(Replies)) != 3 || memcmp(Replies, "\x06\x06\x15", 3) != 0;
+   }
+   double dLatchesPerRound = (double)(Chain.ulLatchCount - ulLatchStart) / ulRounds;
+
+   //A batch latches once, even when a countdown op in it shows its first number before the ops after it run
+   uint8_t Batch[] = {BINARY_OP_COUNTDOWN, 0, 42, BINARY_OP_SEGMENTS, 0, 1, SEG_G};
+   DisplayDriver BatchExpected;
+   BatchExpected.SetNumber(42, 0);
+   BatchExpected.SetSegments(0, DisplayWiring::Map(SEG_G));
+   uint8_t Frame[BINARY_FRAME_MAX_BODY + BINARY_FRAME_OVERHEAD];
+   size_t FrameLength = BuildBinaryFrame(Batch, sizeof(Batch), Frame);
+   unsigned long ulBatchLatchStart = Chain.ulLatchCount;
+   HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+   Client.Send(Frame, FrameLength);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   unsigned long ulBatchLatches = Chain.ulLatchCount - ulBatchLatchStart;
+   bool bBatchShown = Chain.Latched == std::vector<uint8_t>(BatchExpected.GetFrame(), BatchExpected.GetFrame() + BENCH_NUM_DIGITS);
+
+   //After a bad version or length byte the rest of the frame is dropped up to the next frame or newline, an ENQ or
+   //newline in it must not be answered or end a text message
+   uint8_t Replies[8];
+   while (Client.Receive(Replies, sizeof(Replies)) > 0)
+   {
+   }
+   uint8_t Number[] = {BINARY_OP_SET_NUMBER, 0x10, 0xE1, 0}; //4321
+   uint8_t BadVersion[32] = {BINARY_FRAME_START, BINARY_FRAME_VERSION + 1, 4, ENQ_MSG, '0', '0', '7', 0x55};
+   size_t BadLength = 8 + BuildBinaryFrame(Number, sizeof(Number), BadVersion + 8);
+   const uint8_t BadSize[] = {BINARY_FRAME_START, BINARY_FRAME_VERSION, 0, ENQ_MSG, '8', '8', '\n', '1', '2', '3', '4', '\n'};
+   HostArduino::RecordLatches(true);
+   HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+   Client.Send(BadVersion, BadLength);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   size_t ReplyLength = Client.Receive(Replies, sizeof(Replies));
+   bool bResynced = ReplyLength == 2 && Replies[0] == NAK_MSG && Replies[1] == ACK_MSG && Chain.Latched == NumberFrame(4321, 0);
+   HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+   Client.Send(BadSize, sizeof(BadSize));
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   ReplyLength = Client.Receive(Replies, sizeof(Replies));
+   bResynced &= ReplyLength == 2 && Replies[0] == NAK_MSG && Replies[1] == ACK_MSG && Chain.Latched == NumberFrame(1234, 2) &&
+                Chain.LatchHistory.size() == 2;
+   HostArduino::RecordLatches(false);
+   Client.Close();
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   printf("binary frames:   %lu rounds (text, frame, bad frame): %.2f latches/round | %lu wrong values | %lu wrong replies | frame shown after p50 %.2f us | countdown batch %s (%lu latches)\r\n",
+          ulRounds, dLatchesPerRound, Failures(ulWrongValue), Failures(ulWrongReplies), Percentile(Latencies, 0.5),
+          Outcome(bBatchShown && ulBatchLatches == 1, "latched once", "NOT LATCHED ONCE"), ulBatchLatches);
+   printf("                 bad frame header: rest of the frame %s\r\n", Outcome(bResynced, "dropped", "NOT DROPPED"));
+}
+
+//Group addressed UDP updates, alternating text to all displays and binary frames to this group.
+//Every update is followed by a duplicate, a packet for another group and a late packet, none of which may show.
+static void BenchUdpUpdates(unsigned long ulRounds)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   UdpListenerStats Start = UpdateListener.GetStats();
+   std::vector<double> Latencies;
+   unsigned long ulWrongValue = 0;
+   uint16_t iSequence = BENCH_UDP_FIRST_SEQUENCE;
+   for (unsigned long r = 0; r < ulRounds; r++)
+   {
+      long lValue = (long)(r * 37 % 10000);
+      uint8_t Packet[64];
+      size_t Length;
+      iSequence++;
+      if (r % 2 == 0)
+      {
+         Length = sprintf((char *)Packet, "%u:%u:%li\n", UDP_BROADCAST_GROUP, iSequence, lValue);
+      }
+      else
+      {
+         uint8_t Body[] = {BINARY_OP_SET_NUMBER, (uint8_t)(lValue >> 8), (uint8_t)lValue, 2};
+         Length = sprintf((char *)Packet, "%u:%u:", BENCH_UDP_GROUP, iSequence);
+         Length += BuildBinaryFrame(Body, sizeof(Body), Packet + Length);
+      }
+      char szOtherGroup[32], szLate[32];
+      sprintf(szOtherGroup, "%u:%u:9999", BENCH_UDP_GROUP + 1, (uint16_t)(iSequence + 1));
+      sprintf(szLate, "%u:%u:8888", UDP_BROADCAST_GROUP, (uint16_t)(iSequence - 1));
+
+      DisplayDriver Expected;
+      Expected.SetNumber(lValue, 2);
+      std::vector<uint8_t> ExpectedFrame(Expected.GetFrame(), Expected.GetFrame() + BENCH_NUM_DIGITS);
+
+      auto StartTime = BenchClock::now();
+      HostArduino::SendPacket(BENCH_SERVER_PORT, Packet, Length);
+      HostArduino::SendPacket(BENCH_SERVER_PORT, Packet, Length);
+      HostArduino::SendPacket(BENCH_SERVER_PORT, szOtherGroup);
+      HostArduino::SendPacket(BENCH_SERVER_PORT, szLate);
+      int iLoops = 0;
+      while (Chain.Latched != ExpectedFrame && iLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+      {
+         loop();
+         iLoops++;
+      }
+      Latencies.push_back(ElapsedMicros(StartTime));
+      for (int i = 0; i < 5; i++)
+      {
+         loop();
+      }
+      ulWrongValue += Chain.Latched != ExpectedFrame;
+   }
+
+   UdpListenerStats Stats = UpdateListener.GetStats();
+
+   //A sender which starts over is only accepted after UDP_SEQUENCE_TIMEOUT, its sequence must be older however few rounds ran
+   char szRestart[32], szReset[32];
+   sprintf(szRestart, "0:%u:CLR", (uint16_t)(iSequence - 1000));
+   sprintf(szReset, "0:%u:RSTNW", (uint16_t)(iSequence - 999));
+   HostArduino::SendPacket(BENCH_SERVER_PORT, szRestart);
+   loop();
+   bool bRestartRejected = UpdateListener.GetStats().ulStale == Stats.ulStale + 1;
+   HostArduino::AdvanceClock(UDP_SEQUENCE_TIMEOUT);
+   HostArduino::SendPacket(BENCH_SERVER_PORT, szRestart);
+   loop();
+   bool bRestartAccepted = UpdateListener.GetStats().ulAccepted == Stats.ulAccepted + 1;
+
+   //Packets aren't authenticated, a network reset is refused (accepting it ends the run through ESP.restart())
+   HostArduino::SendPacket(BENCH_SERVER_PORT, szReset);
+   for (int i = 0; i < 5; i++)
+   {
+      loop();
+   }
+   bool bResetRefused = UpdateListener.GetStats().ulAccepted == Stats.ulAccepted + 2;
+
+   printf("udp updates:     %lu rounds (update, duplicate, other group, late): %lu accepted | %lu stale | %lu other group | %lu wrong values | shown after p50 %.2f us\r\n",
+          ulRounds, Stats.ulAccepted - Start.ulAccepted, Stats.ulStale - Start.ulStale, Stats.ulOtherGroup - Start.ulOtherGroup,
+          Failures(ulWrongValue), Percentile(Latencies, 0.5));
+   printf("udp restart:     old sequence %s before the timeout, %s after it | RSTNW %s\r\n", Outcome(bRestartRejected, "dropped", "NOT dropped"),
+          Outcome(bRestartAccepted, "accepted", "NOT accepted"), Outcome(bResetRefused, "refused", "NOT REFUSED"));
+}
+
+//A network stall delivers a backlog of running times at once, the display should end up on the newest one.
+//A countdown in the middle of the burst must still be started.
+static void BenchCoalescing(unsigned long ulBursts)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   std::vector<double> Latencies;
+   unsigned long ulWrongValue = 0, ulMissingAcks = 0;
+   unsigned long ulDroppedStart = ulDroppedNumberUpdates;
+   unsigned long ulShiftedStart = Chain.ulBytesShifted;
+   long lValue = 0;
+   for (unsigned long i = 0; i < ulBursts; i++)
+   {
+      char szBurst[BENCH_COALESCE_BURST * 8];
+      size_t Length = 0;
+      for (int j = 0; j < BENCH_COALESCE_BURST; j++)
+      {
+         lValue = (lValue + 1) % 10000;
+         Length += sprintf(szBurst + Length, j == BENCH_COALESCE_BURST / 2 ? "CD%li\n" : "%04li\n", lValue);
+      }
+
+      DisplayDriver Expected;
+      Expected.SetNumber(lValue, 2);
+      std::vector<uint8_t> ExpectedFrame(Expected.GetFrame(), Expected.GetFrame() + BENCH_NUM_DIGITS);
+
+      HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+      auto Start = BenchClock::now();
+      Client.Send(szBurst);
+      int iLoops = 0;
+      while (Chain.Latched != ExpectedFrame && iLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+      {
+         loop();
+         iLoops++;
+      }
+      if (Chain.Latched != ExpectedFrame)
+      {
+         ulWrongValue++;
+         continue;
+      }
+      Latencies.push_back(ElapsedMicros(Start));
+
+      uint8_t Acks[BENCH_COALESCE_BURST];
+      if (Client.Receive(Acks, sizeof(Acks)) != sizeof(Acks))
+      {
+         ulMissingAcks++;
+      }
+   }
+   Client.Close();
+
+   printf("coalescing:      %s | %.2f of %d updates skipped/burst | %.1f bytes shifted/burst | newest shown after p50 %.2f us, max %.2f us\r\n",
+          COALESCE_NUMBERS ? "on" : "off", (double)(ulDroppedNumberUpdates - ulDroppedStart) / ulBursts, BENCH_COALESCE_BURST,
+          (double)(Chain.ulBytesShifted - ulShiftedStart) / ulBursts, Percentile(Latencies, 0.5), Percentile(Latencies, 1.0));
+   if (ulWrongValue > 0 || ulMissingAcks > 0)
+   {
+      bBenchFailed = true;
+      printf("errors:          %lu bursts did not end on the newest value, %lu missing ACKs\r\n", ulWrongValue, ulMissingAcks);
+   }
+}
+
+//Moves the clock to ulMillis before micros() rolls over, running loop() every second on the way so the
+//firmware's timers keep up. A single jump would leave their deadlines more than half the micros() range behind.
+static void SkipToRollover(unsigned long ulMillis)
+{
+   unsigned long ulSkip = (0x100000000ULL - micros()) / 1000 - ulMillis;
+   while (ulSkip > 0)
+   {
+      unsigned long ulStep = ulSkip < 1000 ? ulSkip : 1000;
+      HostArduino::AdvanceClock(ulStep);
+      loop();
+      ulSkip -= ulStep;
+   }
+}
+
+
+//Reset in the middle of a countdown, with a network that takes BENCH_WIFI_CONNECT to come up. The countdown must be
+//back on the display when setup() returns and serial commands must work while WiFi connects. Runs setup().
+static void BenchBoot()
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   DisplayState Before;
+   memset(&Before, 0, sizeof(Before));
+   Before.Mode = DISPLAY_STATE_COUNTDOWN;
+   Before.ulValue = BENCH_BOOT_COUNTDOWN;
+   SaveRtcDisplayState(Before);
+   HostArduino::SetWiFiConnectTime(millis() + BENCH_WIFI_CONNECT);
+   File JsonFile = SPIFFS.open("/config.json", "w");
+   JsonFile.print(BENCH_CONFIG_JSON);
+   JsonFile.close();
+
+   unsigned long ulResetMillis = millis();
+   auto Start = BenchClock::now();
+   setup();
+   double dSetupMicros = ElapsedMicros(Start);
+   bool bRestored = Chain.Latched == NumberFrame(BENCH_BOOT_COUNTDOWN, 0);
+
+   //The countdown keeps going and a serial command is handled while WiFi is still connecting
+   while (millis() - ulResetMillis < 1500)
+   {
+      HostArduino::AdvanceClock(10);
+      loop();
+   }
+   bool bCounting = Chain.Latched == NumberFrame(BENCH_BOOT_COUNTDOWN - 1, 0);
+   unsigned long ulSerialMillis = millis();
+   HostArduino::SerialInput("5678\n");
+   for (int i = 0; i < BENCH_MAX_LOOPS_PER_MESSAGE && Chain.Latched != NumberFrame(5678, 2); i++)
+   {
+      HostArduino::AdvanceClock(1);
+      loop();
+   }
+   bool bSerialShown = Chain.Latched == NumberFrame(5678, 2) && !bBootDone;
+   //Port 80 must stay free for the config portal until WiFi is up
+   bool bHttpWaited = !HostArduino::IsListening(80);
+   ulSerialMillis = millis() - ulSerialMillis;
+
+   while (!bBootDone && millis() < BENCH_WIFI_CONNECT * 2)
+   {
+      HostArduino::AdvanceClock(10);
+      loop();
+   }
+   bHttpWaited &= HTTP_PORT == 0 || HostArduino::IsListening(HTTP_PORT);
+   DisplayState Saved;
+   bool bSaved = LoadRtcDisplayState(Saved) && Saved.Mode == DISPLAY_STATE_STATIC && Saved.Segments[1] == (CanonicalGlyph(6) | SEG_DP);
+
+   bool bMigrated = strcmp(Config.szStaticIp, "192.168.1.23") == 0 && strcmp(Config.szGateway, "192.168.1.1-and") == 0 &&
+                    strcmp(Config.szSubnet, "255.255.255.0") == 0 && Config.iGroup == BENCH_UDP_GROUP &&
+                    !SPIFFS.exists("/config.json") && SPIFFS.exists("/config.json.migrated") && HostArduino::EepromCommitCount() == 1;
+
+   printf("boot:            restored countdown %s after %lu us, setup() %.0f us | %s | serial command %s after %lu ms | WiFi after %lu ms | state %s | config.json %s | HTTP %s\r\n",
+          Outcome(bRestored, "shown", "NOT SHOWN"), (unsigned long)ulBootRestoredMicros, dSetupMicros, Outcome(bCounting, "counting down", "NOT COUNTING"),
+          Outcome(bSerialShown, "shown", "NOT SHOWN"), ulSerialMillis, ulBootWifiMillis, Outcome(bSaved, "saved", "NOT SAVED"), Outcome(bMigrated, "migrated", "NOT MIGRATED"),
+          Outcome(bHttpWaited, "started after WiFi", "NOT AFTER WIFI"));
+}
+
+//The config store after the migration in BenchBoot(): load time, no write for an unchanged config, the display state
+//persisted once it stayed the same long enough, and a damaged record rejected
+static void BenchConfig()
+{
+   DisplayConfig Loaded;
+   ConfigStore Reader;
+   auto Start = BenchClock::now();
+   bool bLoaded = true;
+   for (int i = 0; i < BENCH_CONFIG_LOADS; i++)
+   {
+      bLoaded &= Reader.Load(Loaded);
+   }
+   double dLoadMicros = ElapsedMicros(Start) / BENCH_CONFIG_LOADS;
+   bLoaded &= memcmp(&Loaded, &Config, sizeof(Config)) == 0;
+
+   unsigned long ulCommitStart = HostArduino::EepromCommitCount();
+   Store.Save(Config);
+   bool bUnchangedSkipped = HostArduino::EepromCommitCount() == ulCommitStart;
+
+   //A value that stays shown is persisted once, in the other slot
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   Client.Send("4321\n");
+   for (unsigned long i = 0; i < BENCH_PERSIST_WAIT / 100; i++)
+   {
+      HostArduino::AdvanceClock(100);
+      loop();
+   }
+   Client.Close();
+   bool bPersisted = Config.bLastStateValid && Config.LastState.Segments[1] == (CanonicalGlyph(3) | SEG_DP) &&
+                     HostArduino::EepromCommitCount() - ulCommitStart == 1;
+   Reader.Load(Loaded);
+   bPersisted &= memcmp(&Loaded, &Config, sizeof(Config)) == 0;
+
+   //A damaged record must not be used, the defaults are
+   unsigned long ulCommits = HostArduino::EepromCommitCount() - ulCommitStart;
+   EEPROM.begin(CONFIG_EEPROM_SIZE);
+   EEPROM.write(12, EEPROM.read(12) ^ 0x01); //First byte of the config, behind magic, version and length
+   EEPROM.end();
+   DisplayConfig Damaged;
+   memset(&Damaged, 0, sizeof(Damaged));
+   bool bRejected = !Reader.Load(Damaged) && Damaged.szStaticIp[0] == '\0';
+
+   printf("config store:    load %.2f us | %s | unchanged save %s | display state %s after %lu writes | damaged record %s\r\n",
+          dLoadMicros, Outcome(bLoaded, "matches", "DIFFERS"), Outcome(bUnchangedSkipped, "skipped", "WRITTEN"), Outcome(bPersisted, "persisted", "NOT PERSISTED"),
+          ulCommits, Outcome(bRejected, "rejected", "NOT REJECTED"));
+
+   //Put it back for the benchmarks after this one
+   Store = ConfigStore();
+   Store.Save(Config);
+}
+
+//Serial lines arriving in pieces while network messages come in. Each round a network number arrives between the two
+//halves of a serial line, both must show in order. Then an over-long serial line and a burst of lines at once.
+static void BenchSerialInput(unsigned long ulRounds)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   unsigned long ulWrongValue = 0;
+   for (unsigned long r = 0; r < ulRounds; r++)
+   {
+      int iSerialValue = 1000 + (int)(r % 9000);
+      int iNetworkValue = 9999 - (int)(r % 9000);
+      char szSerial[16], szNetwork[16];
+      sprintf(szSerial, "%i\n", iSerialValue);
+      sprintf(szNetwork, "%i\n", iNetworkValue);
+
+      HostArduino::AdvanceClock(BENCH_BURST_INTERVAL);
+      HostArduino::SerialInput(std::string(szSerial, 2).c_str());
+      loop();
+      Client.Send(szNetwork);
+      loop();
+      ulWrongValue += Chain.Latched != NumberFrame(iNetworkValue, 2);
+      HostArduino::SerialInput(szSerial + 2);
+      loop();
+      ulWrongValue += Chain.Latched != NumberFrame(iSerialValue, 2);
+   }
+   uint8_t Acks[256];
+   while (Client.Receive(Acks, sizeof(Acks)) > 0)
+   {
+   }
+   Client.Close();
+
+   //A line that doesn't fit is dropped up to its newline, the line after it still shows
+   unsigned long ulOverflowStart = SerialCommands.GetOverflowCount();
+   HostArduino::SerialInput(std::string(3 * SERIAL_BUFFER_SIZE, '7').c_str());
+   HostArduino::SerialInput("\n4242\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   //A line that fits the buffer but not a queued message is dropped too, rather than cut down to a valid command
+   HostArduino::SerialInput(("CLR" + std::string(36, ' ') + "\n").c_str());
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   bool bOverlongDropped = Chain.Latched == NumberFrame(4242, 2) && SerialCommands.GetOverflowCount() - ulOverflowStart == 2;
+
+   //A burst is read a budget at a time, the loop never waits for the UART
+   std::string Burst;
+   for (int i = 0; i < BENCH_SERIAL_BURST; i++)
+   {
+      Burst += std::to_string(100 + i) + "\n";
+   }
+   HostArduino::SerialInput(Burst.c_str());
+   double dMaxLoop = 0;
+   int iLoops = 0;
+   while (Chain.Latched != NumberFrame(100 + BENCH_SERIAL_BURST - 1, 2) && iLoops < BENCH_MAX_LOOPS_PER_MESSAGE)
+   {
+      auto Start = BenchClock::now();
+      loop();
+      dMaxLoop = std::max(dMaxLoop, ElapsedMicros(Start));
+      iLoops++;
+   }
+   bool bBurstShown = Chain.Latched == NumberFrame(100 + BENCH_SERIAL_BURST - 1, 2);
+
+   printf("serial input:    %lu rounds (half serial line, network, rest of the line): %lu wrong values | over-long line %s | %d line burst %s after %d loops, max loop %.1f us\r\n",
+          ulRounds, Failures(ulWrongValue), Outcome(bOverlongDropped, "dropped", "NOT DROPPED"), BENCH_SERIAL_BURST, Outcome(bBurstShown, "shown", "NOT SHOWN"), iLoops, dMaxLoop);
+}
+
+//A run on the display's own stopwatch, across a micros() rollover. The display must follow the time to the hundredth
+//with one latch per change of the shown digits, and freeze on the stop and final time commands.
+static void BenchStopwatch()
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   SkipToRollover(BENCH_STOPWATCH_ROLLOVER);
+
+   char szStart[16];
+   sprintf(szStart, "SW%i\n", BENCH_STOPWATCH_OFFSET);
+   Client.Send(szStart);
+   unsigned long ulStartMicros = micros();
+   loop();
+   unsigned long ulLatchStart = Chain.ulLatchCount;
+   unsigned long ulWrongTimes = 0;
+   for (int i = 0; i < BENCH_STOPWATCH_RUN; i++)
+   {
+      HostArduino::AdvanceClock(1);
+      loop();
+      //The stopwatch may be a hundredth behind, it read micros() a moment before this check
+      long lExpected = (uint32_t)(micros() - ulStartMicros) / 10000 + BENCH_STOPWATCH_OFFSET;
+      ulWrongTimes += Chain.Latched != NumberFrame(lExpected, 2) && Chain.Latched != NumberFrame(lExpected - 1, 2);
+   }
+   unsigned long ulRunLatches = Chain.ulLatchCount - ulLatchStart;
+
+   Client.Send("SWS\n");
+   HostArduino::AdvanceClock(BENCH_MESSAGE_INTERVAL);
+   loop();
+   std::vector<uint8_t> StoppedFrame = Chain.Latched;
+   ulLatchStart = Chain.ulLatchCount;
+   for (int i = 0; i < 1000; i++)
+   {
+      HostArduino::AdvanceClock(1);
+      loop();
+   }
+   bool bFrozen = Chain.ulLatchCount == ulLatchStart && Chain.Latched == StoppedFrame;
+
+   Client.Send("SWF12345\n");
+   HostArduino::AdvanceClock(BENCH_MESSAGE_INTERVAL);
+   loop();
+   bool bFinal = Chain.Latched == NumberFrame(1234, 1);
+   Client.Close();
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   printf("stopwatch:       %i ms run across a micros() rollover: %lu latches (%.2f per hundredth) | %lu wrong times | %s when stopped | final time %s\r\n",
+          BENCH_STOPWATCH_RUN, ulRunLatches, ulRunLatches / (BENCH_STOPWATCH_RUN / 10.0), Failures(ulWrongTimes), Outcome(bFrozen, "frozen", "NOT frozen"),
+          Outcome(bFinal, "shown", "NOT shown"));
+}
+
+static uint32_t HostMicros()
+{
+   return (uint32_t)(micros() + BENCH_HOST_CLOCK_OFFSET);
+}
+
+//Reads a clock sync answer, skipping ACKs, returns false if there is none
+static bool ReceiveTimeSyncAnswer(HostArduino::FakeClient &Client, unsigned long &ulDisplayReceive, unsigned long &ulDisplaySend)
+{
+   uint8_t Buffer[64];
+   size_t Received = Client.Receive(Buffer, sizeof(Buffer) - 1);
+   Buffer[Received] = '\0';
+   const char *szAnswer = strchr((const char *)Buffer, 'T');
+   unsigned long ulHostSend;
+   return szAnswer != NULL && sscanf(szAnswer, "T%lu,%lu,%lu", &ulHostSend, &ulDisplayReceive, &ulDisplaySend) == 3;
+}
+
+//Latches scheduled with AT on a clock synced over a jittery network. Each round syncs the clock with a fresh set of
+//exchanges and then schedules a number. The latch may be off by at most half the round trip clock sync picked,
+//plus the 1 ms the bench advances the clock per loop().
+static void BenchScheduledLatch(unsigned long ulRounds)
+{
+   auto &Chain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   uint32_t Random = 777;
+   auto Jitter = [&Random]() {
+      Random = Random * 1103515245 + 12345;
+      return 1 + (Random >> 16) % BENCH_JITTER_MAX;
+   };
+
+   std::vector<double> Errors;
+   unsigned long ulOutOfBound = 0, ulMissed = 0, ulShiftedAtLatch = 0, ulBadAnswers = 0;
+   double dMaxBound = 0;
+   for (unsigned long r = 0; r < ulRounds; r++)
+   {
+      for (int i = 0; i < CLOCK_SYNC_SAMPLES; i++)
+      {
+         char szMessage[40];
+         unsigned long ulHostSend = HostMicros();
+         sprintf(szMessage, "TS%lu\n", ulHostSend);
+         HostArduino::AdvanceClock(Jitter());
+         Client.Send(szMessage);
+         loop();
+         unsigned long ulDisplayReceive, ulDisplaySend;
+         ulBadAnswers += !ReceiveTimeSyncAnswer(Client, ulDisplayReceive, ulDisplaySend);
+         HostArduino::AdvanceClock(Jitter());
+         sprintf(szMessage, "TSR%lu,%lu\n", ulHostSend, (unsigned long)HostMicros());
+         Client.Send(szMessage);
+         loop();
+      }
+
+      long lValue = (long)(r * 7 % 10000);
+      char szSchedule[40];
+      uint32_t ulHostTarget = HostMicros() + BENCH_SCHEDULE_AHEAD;
+      sprintf(szSchedule, "AT%lu %li\n", (unsigned long)ulHostTarget, lValue);
+      HostArduino::AdvanceClock(Jitter());
+      Client.Send(szSchedule);
+      loop();
+
+      std::vector<uint8_t> ExpectedFrame = NumberFrame(lValue, 2);
+      unsigned long ulShiftedStart = Chain.ulBytesShifted;
+      for (int i = 0; i < BENCH_SCHEDULE_AHEAD / 1000 + 2 * BENCH_JITTER_MAX && Chain.Latched != ExpectedFrame; i++)
+      {
+         HostArduino::AdvanceClock(1);
+         loop();
+      }
+      if (Chain.Latched != ExpectedFrame)
+      {
+         ulMissed++;
+         continue;
+      }
+      ulShiftedAtLatch += Chain.ulBytesShifted - ulShiftedStart;
+
+      double dError = (int32_t)(Chain.ulLastLatchMicros - (ulHostTarget - BENCH_HOST_CLOCK_OFFSET));
+      double dBound = HostClock.GetRoundTrip() / 2.0 + 1000;
+      dMaxBound = std::max(dMaxBound, dBound);
+      Errors.push_back(fabs(dError));
+      ulOutOfBound += fabs(dError) > dBound;
+
+      uint8_t Acks[64];
+      Client.Receive(Acks, sizeof(Acks));
+   }
+   Client.Close();
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+
+   printf("scheduled latch: %lu rounds, %i syncs each, 1-%i ms jitter: error p50 %.0f us | max %.0f us | %lu over bound (max %.0f us) | %lu missed | %lu bytes shifted at latch time\r\n",
+          ulRounds, CLOCK_SYNC_SAMPLES, BENCH_JITTER_MAX, Percentile(Errors, 0.5), Percentile(Errors, 1.0), Failures(ulOutOfBound), dMaxBound,
+          Failures(ulMissed), ulShiftedAtLatch);
+   if (ulBadAnswers > 0)
+   {
+      bBenchFailed = true;
+      printf("errors:          %lu clock sync requests not answered\r\n", ulBadAnswers);
+   }
+}
+
+static TaskScheduler BenchTasks;
+static uint8_t iBenchChainTask = TASK_INVALID;
+static unsigned long ulBenchPeriodicRuns = 0;
+static unsigned long ulBenchChainRuns = 0;
+
+static void BenchPeriodicTask()
+{
+   ulBenchPeriodicRuns++;
+}
+
+static void BenchChainTask()
+{
+   ulBenchChainRuns++;
+   BenchTasks.RunIn(iBenchChainTask, BENCH_TASK_CHAIN_DELAY * 1000);
+}
+
+//Deadlines across a micros() rollover. A periodic task must run once per period without drifting, a stalled loop()
+//must skip the missed periods instead of running them back to back, and the firmware's timers only run when due.
+static void BenchTaskScheduler()
+{
+   SkipToRollover(BENCH_TASK_ROLLOVER);
+   uint8_t iPeriodicTask = BenchTasks.Add("periodic", BenchPeriodicTask, BENCH_TASK_PERIOD * 1000);
+   iBenchChainTask = BenchTasks.Add("chain", BenchChainTask);
+   BenchTasks.RunIn(iBenchChainTask, 0);
+   for (int i = 0; i < BENCH_TASK_RUN; i++)
+   {
+      HostArduino::AdvanceClock(1);
+      BenchTasks.Loop();
+   }
+   const TaskStats &Periodic = BenchTasks.GetStats(iPeriodicTask);
+   const TaskStats &Chain = BenchTasks.GetStats(iBenchChainTask);
+   unsigned long ulPeriodicRuns = ulBenchPeriodicRuns;
+   unsigned long ulChainRuns = ulBenchChainRuns;
+   unsigned long ulMaxLate = Periodic.ulMaxLateMicros > Chain.ulMaxLateMicros ? Periodic.ulMaxLateMicros : Chain.ulMaxLateMicros;
+
+   HostArduino::AdvanceClock(BENCH_TASK_STALL);
+   BenchTasks.Loop();
+   BenchTasks.Loop();
+   unsigned long ulStallRuns = ulBenchPeriodicRuns - ulPeriodicRuns;
+
+   printf("task scheduler:  %i ms across a micros() rollover: %lu of %i periodic runs | %lu of %i chained runs | max late %lu us | %i ms stall: %lu run, %lu skipped\r\n",
+          BENCH_TASK_RUN, ulPeriodicRuns, BENCH_TASK_RUN / BENCH_TASK_PERIOD, ulChainRuns, BENCH_TASK_RUN / BENCH_TASK_CHAIN_DELAY + 1,
+          ulMaxLate, BENCH_TASK_STALL, ulStallRuns, Periodic.ulSkipped);
+
+   //The firmware's own timers, with a countdown running over the rollover
+   auto &SegmentChain = HostArduino::GetShiftRegister();
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   loop();
+   SkipToRollover(BENCH_TASK_COUNTDOWN * 500);
+   Tasks.ResetStats();
+   char szCountDown[16];
+   sprintf(szCountDown, "CD%i\n", BENCH_TASK_COUNTDOWN);
+   Client.Send(szCountDown);
+   loop();
+   unsigned long ulLatchStart = SegmentChain.ulLatchCount;
+   unsigned long ulTaskLoops = 0;
+   for (int i = 0; i < BENCH_TASK_RUN; i++)
+   {
+      HostArduino::AdvanceClock(1);
+      loop();
+      ulTaskLoops += Tasks.GetMicrosToNextTask() == 0;
+   }
+   bool bCountDownDone = SegmentChain.Latched == NumberFrame(0, 0);
+   unsigned long ulCountDownLatches = SegmentChain.ulLatchCount - ulLatchStart;
+   Client.Close();
+   loop();
+
+   printf("firmware tasks:  %i ms, %i s countdown across the rollover: %lu latches, %s | %lu loops left a task due |",
+          BENCH_TASK_RUN, BENCH_TASK_COUNTDOWN, ulCountDownLatches, Outcome(bCountDownDone, "ended on 0", "NOT ended on 0"), ulTaskLoops);
+   for (uint8_t i = 0; i < Tasks.GetTaskCount(); i++)
+   {
+      const TaskStats &Stats = Tasks.GetStats(i);
+      printf(" %s %lu (late max %lu us)", Tasks.GetName(i), Stats.ulRuns, Stats.ulMaxLateMicros);
+   }
+   printf("\r\n");
+}
+
+//The STATS answer over TCP and the serial port, and what recording a histogram sample costs
+static void BenchStats()
+{
+#if !METRICS_ENABLED
+   printf("stats:           compiled out (METRICS_ENABLED=0)\r\n");
+   return;
+#endif
+   auto Client = HostArduino::Connect(BENCH_SERVER_PORT);
+   loop();
+   Client.Send("STATS\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   uint8_t Buffer[512];
+   size_t Received = Client.Receive(Buffer, sizeof(Buffer));
+   std::string strReply;
+   for (size_t i = 0; i < Received; i++)
+   {
+      if (Buffer[i] != ACK_MSG)
+      {
+         strReply += (char)Buffer[i];
+      }
+   }
+   bool bValid = strReply.compare(0, 9, "STATS up:") == 0 && strReply.find(" slots:") != std::string::npos && strReply.back() == '\n' &&
+                 strReply.find('\n') == strReply.size() - 1;
+   Client.Close();
+
+   unsigned long ulSerialStart = HostArduino::SerialBytesWritten();
+   HostArduino::SerialInput("STATS\n");
+   for (int i = 0; i < 100; i++)
+   {
+      loop();
+   }
+   unsigned long ulSerialBytes = HostArduino::SerialBytesWritten() - ulSerialStart;
+
+   DurationHistogram Histogram;
+   auto Start = BenchClock::now();
+   for (uint32_t i = 0; i < BENCH_METRICS_SAMPLES; i++)
+   {
+      Histogram.Record(i & 0x3FFF);
+   }
+   double dRecordNanos = ElapsedMicros(Start) * 1000 / BENCH_METRICS_SAMPLES;
+
+   printf("stats:           %zu byte reply over TCP (%s), %lu bytes on serial | %.2f ns/histogram sample, p50 %lu us of 0-16383\r\n",
+          strReply.size(), Outcome(bValid, "valid", "INVALID"), ulSerialBytes, dRecordNanos, (unsigned long)Histogram.GetPercentile(50));
+   printf("                 %s", strReply.c_str());
+}
+
+#if HTTP_PORT && WEBSOCKET_PORT
+//Sends one HTTP request, runs loop() until the display closed the connection and returns the whole response
+static std::string HttpRequest(const char *szRequest, double &dMaxLoop)
+{
+   auto Client = HostArduino::Connect(HTTP_PORT);
+   Client.Send(szRequest);
+   dMaxLoop = 0;
+   for (int i = 0; i < 10 && Client.IsOpen(); i++)
+   {
+      dMaxLoop = std::max(dMaxLoop, TimedLoop());
+   }
+   std::string strResponse(Client.ReceivedCount(), '\0');
+   Client.Receive((uint8_t *)&strResponse[0], strResponse.size());
+   Client.Close();
+   return strResponse;
+}
+
+//Splits the WebSocket frames after the handshake response into their text payloads
+static std::vector<std::string> WebSocketMessages(const std::vector<uint8_t> &Data, size_t &Offset)
+{
+   std::vector<std::string> Messages;
+   while (Offset + 2 <= Data.size() && Offset + 2 + (Data[Offset + 1] & 0x7F) <= Data.size())
+   {
+      size_t Length = Data[Offset + 1] & 0x7F;
+      Messages.push_back(std::string(Data.begin() + Offset + 2, Data.begin() + Offset + 2 + Length));
+      Offset += 2 + Length;
+   }
+   return Messages;
+}
+
+//Status document and control API over HTTP, then a browser mirroring a 100 Hz update stream over the WebSocket
+static void BenchHttp()
+{
+   double dStatusLoop = 0, dCommandLoop = 0;
+   std::string strCommand = HttpRequest("GET /command?cmd=1234 HTTP/1.1\r\nHost: display\r\n\r\n", dCommandLoop);
+   std::string strRefused = HttpRequest("POST /command?cmd=STATS HTTP/1.1\r\nHost: display\r\n\r\n", dCommandLoop);
+   std::string strStatus = HttpRequest("GET /status HTTP/1.1\r\nHost: display\r\n\r\n", dStatusLoop);
+   size_t BodyStart = strStatus.find("\r\n\r\n");
+   std::string strBody = BodyStart == std::string::npos ? "" : strStatus.substr(BodyStart + 4);
+   int iDepth = 0, iMinDepth = 0;
+   for (char c : strBody)
+   {
+      iDepth += (c == '{' || c == '[') - (c == '}' || c == ']');
+      iMinDepth = std::min(iMinDepth, iDepth);
+   }
+   bool bStatusValid = strStatus.compare(0, 15, "HTTP/1.1 200 OK") == 0 && !strBody.empty() && strBody.front() == '{' &&
+                       strBody.compare(strBody.size() - 2, 2, "}\n") == 0 && iDepth == 0 && iMinDepth == 0 &&
+                       strBody.find("\"display\":\"12.34\"") != std::string::npos && strBody.find("\"clients\":[{") != std::string::npos;
+   bool bCommandValid = strCommand.find("{\"accepted\":true}") != std::string::npos && strRefused.find("{\"accepted\":false}") != std::string::npos;
+
+   //Let the push task pick up 1234, a browser that opens gets the last pushed state. RFC 6455 example key and its accept value.
+   HostArduino::AdvanceClock(BENCH_PUSH_INTERVAL);
+   loop();
+   auto Browser = HostArduino::Connect(WEBSOCKET_PORT);
+   Browser.Send("GET / HTTP/1.1\r\nHost: display\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+   auto Stalled = HostArduino::Connect(WEBSOCKET_PORT);
+   Stalled.Send("GET / HTTP/1.1\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n");
+   for (int i = 0; i < 10; i++)
+   {
+      loop();
+   }
+   Stalled.SetTxSpace(0);
+   auto &BrowserData = Browser.GetConnection().TxData;
+   std::string strHandshake(BrowserData.begin(), BrowserData.end());
+   size_t Offset = strHandshake.find("\r\n\r\n");
+   bool bHandshakeValid = strHandshake.compare(0, 12, "HTTP/1.1 101") == 0 && Offset != std::string::npos &&
+                          strHandshake.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos;
+   Offset = Offset == std::string::npos ? BrowserData.size() : Offset + 4;
+   auto Initial = WebSocketMessages(BrowserData, Offset);
+   bool bInitialValid = Initial.size() == 1 && Initial[0].find("\"display\":\"12.34\"") != std::string::npos;
+
+   //100 Hz number stream, the browser should see at most one message per push interval and end on the last number
+   auto Timer = HostArduino::Connect(BENCH_SERVER_PORT);
+   unsigned long ulSkippedStart = DisplayPush.GetStats().ulSkipped;
+   std::vector<double> PushDelays;
+   unsigned long ulLastChange = millis();
+   char szLast[16] = "";
+   double dMaxLoop = 0;
+   for (unsigned long ulStep = 0; ulStep < BENCH_PUSH_RUN + 2 * BENCH_PUSH_INTERVAL; ulStep++)
+   {
+      if (ulStep < BENCH_PUSH_RUN && ulStep % BENCH_MESSAGE_INTERVAL == 0)
+      {
+         char szMessage[16];
+         snprintf(szMessage, sizeof(szMessage), "%lu\n", 1000 + ulStep / BENCH_MESSAGE_INTERVAL); //Shown as 10.00 up to 10.99
+         Timer.Send(szMessage);
+         snprintf(szLast, sizeof(szLast), "10.%02lu", ulStep / BENCH_MESSAGE_INTERVAL);
+         ulLastChange = millis();
+      }
+      dMaxLoop = std::max(dMaxLoop, TimedLoop());
+      auto Messages = WebSocketMessages(BrowserData, Offset);
+      PushDelays.insert(PushDelays.end(), Messages.size(), (double)(millis() - ulLastChange));
+      if (!Messages.empty() && Messages.back().find(std::string("\"display\":\"") + szLast + "\"") == std::string::npos)
+      {
+         szLast[0] = '\0'; //Pushed something else than the newest number
+      }
+      HostArduino::AdvanceClock(1);
+   }
+   bool bEndedOnLast = szLast[0] != '\0';
+   unsigned long ulSkipped = DisplayPush.GetStats().ulSkipped - ulSkippedStart;
+   Timer.Close();
+   Browser.Send("\x88\x80\x01\x02\x03\x04");
+   for (int i = 0; i < 5; i++)
+   {
+      loop();
+   }
+   bool bCloseAnswered = !Browser.IsOpen();
+   Stalled.Close();
+   for (int i = 0; i < 5; i++)
+   {
+      loop();
+   }
+
+   printf("http status:     %zu byte document (%s) | status loop %.1f us | command %s | %s\r\n", strBody.size(),
+          Outcome(bStatusValid, "valid", "INVALID"), dStatusLoop, Outcome(bCommandValid, "applied, STATS refused", "WRONG ANSWERS"),
+          Outcome(bHandshakeValid && bInitialValid, "WebSocket handshake ok", "WebSocket handshake FAILED"));
+   printf("websocket push:  %d ms at 100 Hz: %zu pushes (max %d), max %.0f ms after a change | %s | stalled browser skipped %lu | max loop %.1f us | close %s\r\n",
+          BENCH_PUSH_RUN, PushDelays.size(), BENCH_PUSH_RUN / BENCH_PUSH_INTERVAL + 1, Percentile(PushDelays, 1.0), Outcome(bEndedOnLast, "ended on the last number", "STALE"),
+          ulSkipped, dMaxLoop, Outcome(bCloseAnswered, "answered", "IGNORED"));
+}
+#else
+static void BenchHttp()
+{
+   printf("http status:     compiled out (HTTP_PORT=0 or WEBSOCKET_PORT=0)\r\n");
+}
+#endif
+
+//Clocks frames through an output backend and returns every byte the shift register chain saw
+template <typename Output>
+static std::vector<uint8_t> RecordOutputStream(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin, const std::vector<uint8_t> &Frames,
+                                               std::vector<uint8_t> &Latched)
+{
+   HostArduino::AttachShiftRegister(DataPin, ClockPin, LatchPin, BENCH_NUM_DIGITS);
+   HostArduino::RecordShiftRegisterStream(true);
+   Output SegmentOutput;
+   SegmentOutput.begin(DataPin, ClockPin, LatchPin);
+   for (size_t i = 0; i + BENCH_NUM_DIGITS <= Frames.size(); i += BENCH_NUM_DIGITS)
+   {
+      SegmentOutput.Write(&Frames[i], BENCH_NUM_DIGITS);
+      SegmentOutput.Latch();
+   }
+   auto &Chain = HostArduino::GetShiftRegister();
+   std::vector<uint8_t> Stream = Chain.Stream;
+   Latched = Chain.Latched;
+   HostArduino::RecordShiftRegisterStream(false);
+   return Stream;
+}
+
+//Every display output backend must put exactly the same bytes into the chain
+static void BenchOutputBackends(unsigned long ulFrames)
+{
+   std::vector<uint8_t> Frames;
+   uint32_t Random = 12345;
+   for (unsigned long i = 0; i < ulFrames * BENCH_NUM_DIGITS; i++)
+   {
+      Random = Random * 1103515245 + 12345;
+      Frames.push_back(Random >> 16);
+   }
+
+   std::vector<uint8_t> BitBangLatched, GpioLatched, SpiLatched;
+   auto BitBang = RecordOutputStream<BitBangSegmentOutput>(BENCH_SEGMENT_DATA, BENCH_SEGMENT_CLOCK, BENCH_SEGMENT_LATCH, Frames, BitBangLatched);
+   auto Gpio = RecordOutputStream<GpioSegmentOutput>(BENCH_SEGMENT_DATA, BENCH_SEGMENT_CLOCK, BENCH_SEGMENT_LATCH, Frames, GpioLatched);
+   auto Spi = RecordOutputStream<SpiSegmentOutput>(MOSI, SCK, BENCH_SEGMENT_LATCH, Frames, SpiLatched);
+
+   bool bMatch = BitBang == Frames && Gpio == Frames && Spi == Frames && BitBangLatched == GpioLatched && BitBangLatched == SpiLatched;
+   printf("output backends: bitbang/gpio/spi byte streams %s (%lu frames, %zu/%zu/%zu bytes)\r\n", Outcome(bMatch, "identical", "DIFFER"),
+          ulFrames, BitBang.size(), Gpio.size(), Spi.size());
+
+   HostArduino::AttachShiftRegister(BENCH_SEGMENT_DATA, BENCH_SEGMENT_CLOCK, BENCH_SEGMENT_LATCH, BENCH_NUM_DIGITS);
+}
+
+//Classification done by the String::indexOf/substring/toInt chain the parser replaced, kept for comparison
+static CommandType LegacyParse(const String &strCommand, long &lValue)
+{
+   if (strCommand.indexOf("CD") > -1)
+   {
+      lValue = strCommand.substring(2).toInt();
+      return COMMAND_COUNTDOWN;
+   }
+   else if (strCommand == "CLR")
+   {
+      return COMMAND_CLEAR;
+   }
+   else if (strCommand == "RSTNW")
+   {
+      return COMMAND_RESET_NETWORK;
+   }
+   else if (strCommand.toInt() >= -999 && strCommand.toInt() <= 9999)
+   {
+      lValue = strCommand.toInt();
+      return COMMAND_NUMBER;
+   }
+   return COMMAND_INVALID;
+}
+
+struct ParserCase
+{
+   const char *szMessage;
+   CommandType Type;
+   long lValue;
+   unsigned long ulTime = 0;
+   unsigned long ulTime2 = 0;
+};
+
+//Second, independent reading of the grammar in CommandParser.h, written as regular expressions.
+//Fills in Type, lValue, ulTime and ulTime2, a scheduled command is only classified.
+static bool ReferenceParse(const std::string &strMessage, ParsedCommand &Command)
+{
+   static const std::regex Number("(-?[0-9]{1,6})[\r \t]*");
+   static const std::regex Keyword("(CD|SWF|SW)(-?[0-9]{1,6})[\r \t]*");
+   static const std::regex Plain("(CLR|RSTNW|SWS|SW|STATS)[\r \t]*");
+   static const std::regex Time("(TSR|TS)([0-9]{1,10})(?:,([0-9]{1,10}))?[\r \t]*");
+   static const std::regex Scheduled("AT([0-9]{1,10}) (.*)");
+   Command = ParsedCommand();
+   std::smatch Match;
+   long lMax = 9999;
+   if (std::regex_match(strMessage, Match, Number))
+   {
+      Command.Type = COMMAND_NUMBER;
+      Command.lValue = std::stol(Match[1]);
+      if (Command.lValue < -999 || Command.lValue > 9999)
+      {
+         Command.Type = COMMAND_INVALID;
+      }
+   }
+   else if (std::regex_match(strMessage, Match, Keyword))
+   {
+      Command.Type = Match[1] == "CD" ? COMMAND_COUNTDOWN : Match[1] == "SW" ? COMMAND_STOPWATCH_START : COMMAND_STOPWATCH_FINAL;
+      lMax = Command.Type == COMMAND_STOPWATCH_FINAL ? 999999 : 9999;
+      Command.lValue = std::stol(Match[2]);
+      if (Command.lValue < 0 || Command.lValue > lMax)
+      {
+         Command.Type = COMMAND_INVALID;
+      }
+   }
+   else if (std::regex_match(strMessage, Match, Plain))
+   {
+      Command.Type = Match[1] == "CLR"     ? COMMAND_CLEAR
+                     : Match[1] == "RSTNW" ? COMMAND_RESET_NETWORK
+                     : Match[1] == "SWS"   ? COMMAND_STOPWATCH_STOP
+                     : Match[1] == "SW"    ? COMMAND_STOPWATCH_START
+                                           : COMMAND_STATS;
+   }
+   else if (std::regex_match(strMessage, Match, Time) && (Match[1] == "TSR") == Match[3].matched)
+   {
+      Command.Type = Match[3].matched ? COMMAND_TIME_SYNC_RESULT : COMMAND_TIME_SYNC;
+      uint64_t ullTime = std::stoull(Match[2]), ullTime2 = Match[3].matched ? std::stoull(Match[3]) : 0;
+      Command.ulTime = ullTime;
+      Command.ulTime2 = ullTime2;
+      if (ullTime > 0xFFFFFFFF || ullTime2 > 0xFFFFFFFF)
+      {
+         Command.Type = COMMAND_INVALID;
+      }
+   }
+   else if (std::regex_match(strMessage, Match, Scheduled))
+   {
+      ParsedCommand Inner;
+      uint64_t ullTime = std::stoull(Match[1]);
+      bool bSchedulable = ReferenceParse(Match[2], Inner) && Inner.Type != COMMAND_RESET_NETWORK && Inner.Type != COMMAND_STATS &&
+                          Inner.Type != COMMAND_TIME_SYNC && Inner.Type != COMMAND_TIME_SYNC_RESULT && Inner.Type != COMMAND_SCHEDULED;
+      Command.ulTime = ullTime;
+      Command.Type = bSchedulable && ullTime <= 0xFFFFFFFF ? COMMAND_SCHEDULED : COMMAND_INVALID;
+   }
+   if (Command.Type == COMMAND_INVALID)
+   {
+      Command = ParsedCommand();
+   }
+   return Command.Type != COMMAND_INVALID;
+}
+
+//True if two parses agree on everything but where the scheduled command starts
+static bool SameParse(const ParsedCommand &Command, const ParsedCommand &Expected)
+{
+   if (Command.Type != Expected.Type)
+   {
+      return false;
+   }
+   if (Command.Type == COMMAND_INVALID)
+   {
+      return true;
+   }
+   return Command.lValue == Expected.lValue && Command.ulTime == Expected.ulTime && Command.ulTime2 == Expected.ulTime2;
+}
+
+//Parse cost per message for the command parser vs the old String chain, plus a fuzz pass over random input
+static void BenchCommandParser(unsigned long ulMessages)
+{
+   //Expected results for every accepted form and the ways each can be rejected
+   static const ParserCase Cases[] = {
+       {"1234", COMMAND_NUMBER, 1234},
+       {"-999", COMMAND_NUMBER, -999},
+       {"0\r", COMMAND_NUMBER, 0},
+       {"9999", COMMAND_NUMBER, 9999},
+       {"000042", COMMAND_NUMBER, 42},
+       {"0000042", COMMAND_INVALID, 0},
+       {"10000", COMMAND_INVALID, 0},
+       {"-1000", COMMAND_INVALID, 0},
+       {"12ab", COMMAND_INVALID, 0},
+       {"12 3", COMMAND_INVALID, 0},
+       {" 12", COMMAND_INVALID, 0},
+       {"", COMMAND_INVALID, 0},
+       {"-", COMMAND_INVALID, 0},
+       {"--5", COMMAND_INVALID, 0},
+       {"CD30", COMMAND_COUNTDOWN, 30},
+       {"CD0", COMMAND_COUNTDOWN, 0},
+       {"CD9999\r", COMMAND_COUNTDOWN, 9999},
+       {"CD10000", COMMAND_INVALID, 0},
+       {"CD-5", COMMAND_INVALID, 0},
+       {"CD", COMMAND_INVALID, 0}, //The String chain started a countdown from 0, a countdown now needs its number
+       {"CD\r", COMMAND_INVALID, 0},
+       {"XCD30", COMMAND_INVALID, 0},
+       {"12CD", COMMAND_INVALID, 0},
+       {"CLR", COMMAND_CLEAR, 0},
+       {"CLR\r", COMMAND_CLEAR, 0},
+       {"CLRX", COMMAND_INVALID, 0},
+       {"RSTNW", COMMAND_RESET_NETWORK, 0},
+       {"clr", COMMAND_INVALID, 0},
+       {"SW", COMMAND_STOPWATCH_START, 0},
+       {"SW25\r", COMMAND_STOPWATCH_START, 25},
+       {"SW 25", COMMAND_INVALID, 0},
+       {"SWS", COMMAND_STOPWATCH_STOP, 0},
+       {"SWS5", COMMAND_INVALID, 0},
+       {"SWF123456", COMMAND_STOPWATCH_FINAL, 123456},
+       {"SWF", COMMAND_INVALID, 0},
+       {"STATS", COMMAND_STATS, 0},
+       {"STATS\r", COMMAND_STATS, 0},
+       {"STATS1", COMMAND_INVALID, 0},
+       {"SW-1", COMMAND_INVALID, 0},
+       {"SW10000", COMMAND_INVALID, 0},
+       {"SWF999999", COMMAND_STOPWATCH_FINAL, 999999},
+       {"SWF1000000", COMMAND_INVALID, 0},
+       {"TS4294967295", COMMAND_TIME_SYNC, 0, 4294967295UL},
+       {"TS4294967296", COMMAND_INVALID, 0},
+       {"TS", COMMAND_INVALID, 0},
+       {"TS12,34", COMMAND_INVALID, 0},
+       {"TSR12,34\r", COMMAND_TIME_SYNC_RESULT, 0, 12, 34},
+       {"TSR12", COMMAND_INVALID, 0},
+       {"TSR12,", COMMAND_INVALID, 0},
+       {"AT500 1234", COMMAND_SCHEDULED, 0, 500},
+       {"AT500 CLR", COMMAND_SCHEDULED, 0, 500},
+       {"AT500 SWF12", COMMAND_SCHEDULED, 0, 500},
+       {"AT500 RSTNW", COMMAND_INVALID, 0},
+       {"AT500 STATS", COMMAND_INVALID, 0},
+       {"AT500 AT600 1", COMMAND_INVALID, 0},
+       {"AT500 12ab", COMMAND_INVALID, 0},
+       {"AT500  1234", COMMAND_INVALID, 0},
+       {"AT500", COMMAND_INVALID, 0},
+   };
+
+   //Both parsers must give the expected result, which also checks the reference used for the fuzz pass below
+   unsigned long ulMismatches = 0;
+   for (auto &Case : Cases)
+   {
+      ParsedCommand Expected, Command, Reference;
+      Expected.Type = Case.Type;
+      Expected.lValue = Case.lValue;
+      Expected.ulTime = Case.ulTime;
+      Expected.ulTime2 = Case.ulTime2;
+      bool bValid = ParseCommand(Case.szMessage, Command);
+      bool bReferenceValid = ReferenceParse(Case.szMessage, Reference);
+      if (!SameParse(Command, Expected) || bValid != (Case.Type != COMMAND_INVALID) || !SameParse(Reference, Expected) ||
+          bReferenceValid != bValid)
+      {
+         printf("parser mismatch: '%s' gave type %i value %li (reference type %i value %li)\r\n", Case.szMessage, Command.Type,
+                Command.lValue, Reference.Type, Reference.lValue);
+         ulMismatches++;
+      }
+   }
+
+   //Random messages built from the characters commands are made of, so a fair share of them is valid
+   static const char Alphabet[] = "0123456789-ACDFLRSTNWX ,\r";
+   std::vector<std::string> Messages;
+   uint32_t Random = 54321;
+   for (unsigned long i = 0; i < ulMessages; i++)
+   {
+      std::string Message;
+      Random = Random * 1103515245 + 12345;
+      size_t Length = (Random >> 16) % BENCH_FUZZ_MAX_LENGTH;
+      for (size_t j = 0; j < Length; j++)
+      {
+         Random = Random * 1103515245 + 12345;
+         Message += Alphabet[(Random >> 16) % (sizeof(Alphabet) - 1)];
+      }
+      Messages.push_back(Message);
+   }
+
+   unsigned long ulValid = 0;
+   for (auto &Message : Messages)
+   {
+      ParsedCommand Command, Reference;
+      bool bValid = ParseCommand(Message.c_str(), Command);
+      if (bValid != ReferenceParse(Message, Reference) || !SameParse(Command, Reference))
+      {
+         printf("parser fuzz: '%s' gave type %i value %li, reference type %i value %li\r\n", Message.c_str(), Command.Type, Command.lValue,
+                Reference.Type, Reference.lValue);
+         ulMismatches++;
+      }
+      ulValid += bValid;
+   }
+
+   std::vector<String> LegacyMessages(Messages.begin(), Messages.end());
+   volatile long lSink = 0;
+
+   ulHeapAllocations = 0;
+   bCountAllocations = true;
+   auto Start = BenchClock::now();
+   for (unsigned int Round = 0; Round < BENCH_PARSE_ROUNDS; Round++)
+   {
+      for (auto &Message : Messages)
+      {
+         ParsedCommand Command;
+         ParseCommand(Message.c_str(), Command);
+         lSink = lSink + Command.lValue;
+      }
+   }
+   double ParserNanos = ElapsedMicros(Start) * 1000.0 / (Messages.size() * BENCH_PARSE_ROUNDS);
+   unsigned long ulParserAllocations = ulHeapAllocations;
+
+   ulHeapAllocations = 0;
+   Start = BenchClock::now();
+   for (unsigned int Round = 0; Round < BENCH_PARSE_ROUNDS; Round++)
+   {
+      for (auto &Message : LegacyMessages)
+      {
+         long lValue = 0;
+         LegacyParse(Message, lValue);
+         lSink = lSink + lValue;
+      }
+   }
+   double LegacyNanos = ElapsedMicros(Start) * 1000.0 / (LegacyMessages.size() * BENCH_PARSE_ROUNDS);
+   unsigned long ulLegacyAllocations = ulHeapAllocations;
+   bCountAllocations = false;
+
+   unsigned long ulParsed = Messages.size() * BENCH_PARSE_ROUNDS;
+   printf("command parser:  %.1f ns/message, %.2f allocations/message (String chain: %.1f ns, %.2f allocations)\r\n", ParserNanos,
+          (double)Failures(ulParserAllocations) / ulParsed, LegacyNanos, (double)ulLegacyAllocations / ulParsed);
+   printf("parser fuzz:     %lu of %zu random messages valid, %lu mismatches\r\n", ulValid, Messages.size(), Failures(ulMismatches));
+}
+
+int main(int argc, char **argv)
+{
+   unsigned long ulMessages = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+
+   HostArduino::AttachShiftRegister(BENCH_SEGMENT_DATA, BENCH_SEGMENT_CLOCK, BENCH_SEGMENT_LATCH, BENCH_NUM_DIGITS);
+
+   printf("WifiNumericDisplay host benchmark\r\n");
+   BenchBoot();
+   BenchIdleLoop();
+   BenchMessageLatency(ulMessages);
+   BenchRepeatedValue(ulMessages);
+   BenchClientBursts(ulMessages / (BENCH_BURST_CLIENTS * BENCH_BURST_MESSAGES) + 1);
+   BenchFairness(ulMessages / 250 + 1);
+   BenchSequencedReplies(ulMessages / 4 + 1);
+   BenchBinaryFrames(ulMessages / 4 + 1);
+   BenchSerialInput(ulMessages / 4 + 1);
+   BenchUdpUpdates(ulMessages / 4 + 1);
+   BenchCoalescing(ulMessages / BENCH_COALESCE_BURST + 1);
+   BenchStopwatch();
+   BenchScheduledLatch(ulMessages / 10 + 1);
+   BenchTaskScheduler();
+   BenchStats();
+   BenchHttp();
+   BenchConfig();
+   BenchOutputBackends(ulMessages);
+   BenchCommandParser(ulMessages);
+   return bBenchFailed ? 1 : 0;
+}
@@ -0,0 +1,409 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Load generator for the port 23 protocol, the standard regression benchmark for the network path.
+//Opens N connections to a display (or host/Loopback.cpp in server mode) and sends numbers, countdowns and ENQs
+//at a fixed rate, then reports ACK round trip percentiles, throughput and errors.
+//Built by [env:loadgen], run .pio/build/loadgen/program -? for the options.
+
+#include <BinaryFrame.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Protocol bytes, must match NetworkServer.h
+#define LOADGEN_ACK 0x06
+#define LOADGEN_NAK 0x15
+#define LOADGEN_ENQ 0x05
+
+typedef std::chrono::steady_clock LoadGenClock;
+
+struct LoadGenOptions
+{
+   std::string strHost = "127.0.0.1";
+   std::string strPort = "23";
+   int iConnections = 1;
+   unsigned long ulMessages = 1000; //Per connection
+   unsigned long ulRate = 100;      //Messages per second per connection
+   unsigned int iWindow = 1;        //Messages that may wait for their ACK at the same time
+   unsigned int iAckTimeout = 2000; //ms
+   bool bSequenced = false;         //Ask for sequence numbered ACK/NAK frames
+   bool bBinary = false;            //Send numbers and countdowns as binary frames
+   //Mix of message types, in parts
+   unsigned int iNumberParts = 1;
+   unsigned int iCountDownParts = 0;
+   unsigned int iEnqParts = 0;
+};
+
+struct ConnectionResult
+{
+   bool bConnected = false;
+   double dConnectMicros = 0;
+   std::vector<double> AckMicros;
+   unsigned long ulSent = 0;
+   unsigned long ulNaks = 0;
+   unsigned long ulTimeouts = 0;
+   unsigned long ulUnexpected = 0;
+   bool bClosedByDisplay = false;
+};
+
+static double ElapsedMicros(LoadGenClock::time_point Start)
+{
+   return std::chrono::duration<double, std::micro>(LoadGenClock::now() - Start).count();
+}
+
+static double Percentile(std::vector<double> &SortedSamples, double Fraction)
+{
+   if (SortedSamples.empty())
+   {
+      return 0;
+   }
+   size_t Index = (size_t)(Fraction * (SortedSamples.size() - 1) + 0.5);
+   return SortedSamples[Index];
+}
+
+static int Connect(const LoadGenOptions &Options)
+{
+   addrinfo Hints = {};
+   Hints.ai_family = AF_INET;
+   Hints.ai_socktype = SOCK_STREAM;
+   addrinfo *Addresses = NULL;
+   if (getaddrinfo(Options.strHost.c_str(), Options.strPort.c_str(), &Hints, &Addresses) != 0)
+   {
+      return -1;
+   }
+   int iSocket = socket(AF_INET, SOCK_STREAM, 0);
+   if (iSocket >= 0 && connect(iSocket, Addresses->ai_addr, Addresses->ai_addrlen) < 0)
+   {
+      close(iSocket);
+      iSocket = -1;
+   }
+   freeaddrinfo(Addresses);
+   if (iSocket >= 0)
+   {
+      int iNoDelay = 1;
+      setsockopt(iSocket, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+   }
+   return iSocket;
+}
+
+//Builds message i of a connection, picking the type from the configured mix
+static std::string BuildMessage(const LoadGenOptions &Options, unsigned long i)
+{
+   unsigned int iParts = Options.iNumberParts + Options.iCountDownParts + Options.iEnqParts;
+   unsigned int iPick = i % iParts;
+   char szMessage[16];
+   if (Options.bBinary && iPick < Options.iNumberParts + Options.iCountDownParts)
+   {
+      bool bNumber = iPick < Options.iNumberParts;
+      unsigned long ulValue = bNumber ? i % 10000 : 10 + i % 90;
+      uint8_t Body[] = {bNumber ? BINARY_OP_SET_NUMBER : BINARY_OP_COUNTDOWN, (uint8_t)(ulValue >> 8), (uint8_t)ulValue, 0};
+      uint8_t Frame[sizeof(Body) + BINARY_FRAME_OVERHEAD];
+      size_t Length = BuildBinaryFrame(Body, bNumber ? 4 : 3, Frame);
+      return std::string((const char *)Frame, Length);
+   }
+   if (iPick < Options.iNumberParts)
+   {
+      snprintf(szMessage, sizeof(szMessage), "%04lu\n", i % 10000);
+   }
+   else if (iPick < Options.iNumberParts + Options.iCountDownParts)
+   {
+      snprintf(szMessage, sizeof(szMessage), "CD%lu\n", 10 + i % 90);
+   }
+   else
+   {
+      szMessage[0] = LOADGEN_ENQ;
+      szMessage[1] = '\0';
+   }
+   return szMessage;
+}
+
+//A message or ENQ waiting for its reply
+struct PendingReply
+{
+   LoadGenClock::time_point SendTime;
+   bool bEnq;
+   uint16_t iSequence; //Sequenced mode only, 0 for ENQs
+};
+
+//Matches one reply with the message it belongs to. Plain replies come back in order, so they belong to the oldest
+//pending message. In sequenced mode ENQ answers are separate frames and message replies must carry the next sequence number.
+static void HandleReply(uint8_t Type, long lSequence, std::deque<PendingReply> &Pending, ConnectionResult &Result)
+{
+   auto Match = Pending.end();
+   for (auto It = Pending.begin(); It != Pending.end(); ++It)
+   {
+      if (lSequence < 0 || It->bEnq == (Type == LOADGEN_ENQ))
+      {
+         Match = It;
+         break;
+      }
+   }
+   if (Match == Pending.end() || (lSequence >= 0 && !Match->bEnq && Match->iSequence != lSequence))
+   {
+      Result.ulUnexpected++;
+      return;
+   }
+
+   if (Type == LOADGEN_NAK)
+   {
+      Result.ulNaks++;
+   }
+   else
+   {
+      Result.AckMicros.push_back(ElapsedMicros(Match->SendTime));
+   }
+   Pending.erase(Match);
+}
+
+static void RunConnection(const LoadGenOptions &Options, ConnectionResult &Result)
+{
+   auto ConnectStart = LoadGenClock::now();
+   int iSocket = Connect(Options);
+   if (iSocket < 0)
+   {
+      return;
+   }
+   Result.bConnected = true;
+   Result.dConnectMicros = ElapsedMicros(ConnectStart);
+
+   std::deque<PendingReply> Pending;
+   uint16_t iSequence = 0;
+   if (Options.bSequenced)
+   {
+      //The display confirms the switch with sequence number 0
+      const char szSwitch[] = "SEQ\n";
+      send(iSocket, szSwitch, sizeof(szSwitch) - 1, MSG_NOSIGNAL);
+      Pending.push_back({LoadGenClock::now(), false, 0});
+      Result.ulSent++;
+   }
+
+   auto Interval = std::chrono::microseconds(1000000 / Options.ulRate);
+   auto AckTimeout = std::chrono::milliseconds(Options.iAckTimeout);
+   auto NextSend = LoadGenClock::now();
+   std::string strFrame; //Partial sequenced reply frame
+   unsigned long i = 0;
+   while (!Result.bClosedByDisplay && (i < Options.ulMessages || !Pending.empty()))
+   {
+      auto Now = LoadGenClock::now();
+      if (i < Options.ulMessages && Now >= NextSend && Pending.size() < Options.iWindow)
+      {
+         std::string strMessage = BuildMessage(Options, i++);
+         NextSend += Interval;
+         if (send(iSocket, strMessage.data(), strMessage.size(), MSG_NOSIGNAL) != (ssize_t)strMessage.size())
+         {
+            Result.bClosedByDisplay = true;
+            break;
+         }
+         bool bEnq = strMessage[0] == LOADGEN_ENQ;
+         Pending.push_back({LoadGenClock::now(), bEnq, bEnq ? (uint16_t)0 : ++iSequence});
+         Result.ulSent++;
+         continue;
+      }
+
+      //Drop messages that waited too long, a late ACK would otherwise be matched with the wrong message
+      while (!Pending.empty() && Now - Pending.front().SendTime > AckTimeout)
+      {
+         Pending.pop_front();
+         Result.ulTimeouts++;
+      }
+
+      //Wait for replies until the next message is due
+      auto Wait = std::chrono::duration_cast<std::chrono::milliseconds>(NextSend - Now).count();
+      if (i >= Options.ulMessages || Pending.size() >= Options.iWindow)
+      {
+         Wait = 10;
+      }
+      pollfd Poll = {iSocket, POLLIN, 0};
+      if (poll(&Poll, 1, std::max<long>(0, std::min<long>(Wait, 10))) <= 0)
+      {
+         continue;
+      }
+      uint8_t Replies[256];
+      ssize_t Received = recv(iSocket, Replies, sizeof(Replies), MSG_DONTWAIT);
+      if (Received == 0)
+      {
+         Result.bClosedByDisplay = true;
+         break;
+      }
+      for (ssize_t r = 0; r < Received; r++)
+      {
+         if (!Options.bSequenced)
+         {
+            if (Replies[r] != LOADGEN_ACK && Replies[r] != LOADGEN_NAK)
+            {
+               Result.ulUnexpected++;
+               continue;
+            }
+            HandleReply(Replies[r], -1, Pending, Result);
+            continue;
+         }
+
+         //Sequenced frames: <ACK|NAK|ENQ><sequence number>\n
+         if (Replies[r] != '\n')
+         {
+            strFrame += (char)Replies[r];
+            continue;
+         }
+         uint8_t Type = strFrame.empty() ? 0 : strFrame[0];
+         if (Type == LOADGEN_ACK || Type == LOADGEN_NAK || Type == LOADGEN_ENQ)
+         {
+            HandleReply(Type, atol(strFrame.c_str() + 1), Pending, Result);
+         }
+         else
+         {
+            Result.ulUnexpected++;
+         }
+         strFrame.clear();
+      }
+   }
+   Result.ulTimeouts += Pending.size();
+   close(iSocket);
+}
+
+static bool ParseMix(const char *szMix, LoadGenOptions &Options)
+{
+   return sscanf(szMix, "%u:%u:%u", &Options.iNumberParts, &Options.iCountDownParts, &Options.iEnqParts) == 3 &&
+          Options.iNumberParts + Options.iCountDownParts + Options.iEnqParts > 0;
+}
+
+static void PrintUsage(const char *szProgram)
+{
+   printf("usage: %s [-h host] [-p port] [-c connections] [-n messages] [-r rate] [-w window] [-t timeout] [-m mix] [-s] [-b]\r\n", szProgram);
+   printf("  -h  display address (127.0.0.1)\r\n");
+   printf("  -p  TCP port (23)\r\n");
+   printf("  -c  connections opened at the same time (1)\r\n");
+   printf("  -n  messages per connection (1000)\r\n");
+   printf("  -r  messages per second per connection (100)\r\n");
+   printf("  -w  messages that may wait for an ACK at the same time, per connection (1)\r\n");
+   printf("  -t  ACK timeout in ms (2000)\r\n");
+   printf("  -m  parts of numbers:countdowns:ENQs (1:0:0)\r\n");
+   printf("  -s  sequenced mode, replies carry the message's sequence number so a window > 1 is matched exactly\r\n");
+   printf("  -b  send numbers and countdowns as binary frames instead of text\r\n");
+}
+
+int main(int argc, char **argv)
+{
+   LoadGenOptions Options;
+   int iOption;
+   while ((iOption = getopt(argc, argv, "h:p:c:n:r:w:t:m:sb")) != -1)
+   {
+      switch (iOption)
+      {
+      case 'h':
+         Options.strHost = optarg;
+         break;
+      case 'p':
+         Options.strPort = optarg;
+         break;
+      case 'c':
+         Options.iConnections = atoi(optarg);
+         break;
+      case 'n':
+         Options.ulMessages = strtoul(optarg, NULL, 10);
+         break;
+      case 'r':
+         Options.ulRate = strtoul(optarg, NULL, 10);
+         break;
+      case 'w':
+         Options.iWindow = atoi(optarg);
+         break;
+      case 't':
+         Options.iAckTimeout = atoi(optarg);
+         break;
+      case 's':
+         Options.bSequenced = true;
+         break;
+      case 'b':
+         Options.bBinary = true;
+         break;
+      case 'm':
+         if (!ParseMix(optarg, Options))
+         {
+            PrintUsage(argv[0]);
+            return 2;
+         }
+         break;
+      default:
+         PrintUsage(argv[0]);
+         return 2;
+      }
+   }
+   if (Options.iConnections < 1 || Options.ulRate < 1 || Options.iWindow < 1)
+   {
+      PrintUsage(argv[0]);
+      return 2;
+   }
+
+   std::vector<ConnectionResult> Results(Options.iConnections);
+   std::vector<std::thread> Threads;
+   auto Start = LoadGenClock::now();
+   for (auto &Result : Results)
+   {
+      Threads.emplace_back(RunConnection, std::cref(Options), std::ref(Result));
+   }
+   for (auto &Thread : Threads)
+   {
+      Thread.join();
+   }
+   double dSeconds = ElapsedMicros(Start) / 1000000;
+
+   std::vector<double> ConnectTimes, AckTimes;
+   unsigned long ulSent = 0, ulNaks = 0, ulTimeouts = 0, ulUnexpected = 0;
+   int iConnected = 0, iClosed = 0;
+   for (auto &Result : Results)
+   {
+      if (Result.bConnected)
+      {
+         iConnected++;
+         ConnectTimes.push_back(Result.dConnectMicros);
+      }
+      iClosed += Result.bClosedByDisplay;
+      AckTimes.insert(AckTimes.end(), Result.AckMicros.begin(), Result.AckMicros.end());
+      ulSent += Result.ulSent;
+      ulNaks += Result.ulNaks;
+      ulTimeouts += Result.ulTimeouts;
+      ulUnexpected += Result.ulUnexpected;
+   }
+   std::sort(ConnectTimes.begin(), ConnectTimes.end());
+   std::sort(AckTimes.begin(), AckTimes.end());
+
+   printf("target:      %s:%s, %i connections x %lu messages at %lu/s, window %u, mix %u:%u:%u%s%s\r\n", Options.strHost.c_str(),
+          Options.strPort.c_str(), Options.iConnections, Options.ulMessages, Options.ulRate, Options.iWindow, Options.iNumberParts,
+          Options.iCountDownParts, Options.iEnqParts, Options.bSequenced ? ", sequenced" : "", Options.bBinary ? ", binary" : "");
+   printf("connections: %i of %i connected (p50 %.0f us, max %.0f us), %i closed by the display\r\n", iConnected, Options.iConnections,
+          Percentile(ConnectTimes, 0.5), Percentile(ConnectTimes, 1.0), iClosed);
+   printf("ACK RTT:     p50 %.0f us | p90 %.0f us | p99 %.0f us | p99.9 %.0f us | max %.0f us\r\n", Percentile(AckTimes, 0.5),
+          Percentile(AckTimes, 0.9), Percentile(AckTimes, 0.99), Percentile(AckTimes, 0.999), Percentile(AckTimes, 1.0));
+   printf("throughput:  %.0f ACKs/s (%lu sent, %zu ACKed in %.2f s)\r\n", AckTimes.size() / dSeconds, ulSent, AckTimes.size(), dSeconds);
+   printf("errors:      %lu NAKs | %lu timeouts | %lu unexpected bytes\r\n", ulNaks, ulTimeouts, ulUnexpected);
+
+   bool bFailed = iConnected < Options.iConnections || iClosed > 0 || ulNaks > 0 || ulTimeouts > 0 || ulUnexpected > 0;
+   return bFailed ? 1 : 0;
+}
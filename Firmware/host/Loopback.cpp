@@ -0,0 +1,291 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Runs NetworkServer on real TCP sockets through lib/PosixTransport and drives it with client threads over loopback.
+//Built by [env:native_loopback], run with: .pio/build/native_loopback/program [clients] [messages per client] [messages/s per client]
+//With 0 clients it only runs the server, for host/LoadGen.cpp or telnet to connect to.
+//A UdpListener for group LOOPBACK_UDP_GROUP runs next to it, fed by one more thread which mixes in duplicate,
+//late and other group packets.
+
+#include <Arduino.h>
+#include <NetworkServer.h>
+#include <UdpListener.h>
+#include <PosixTransport.h>
+#include <CommandParser.h>
+#include <BinaryFrame.h>
+#include <Log.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define LOOPBACK_PORT 2323
+#define LOOPBACK_SLOTS 16
+#define LOOPBACK_ACK_TIMEOUT 2 //Seconds a client waits for an ACK before counting an error
+#define LOOPBACK_UDP_PORT 2323
+#define LOOPBACK_UDP_GROUP 1
+
+typedef std::chrono::steady_clock LoopbackClock;
+
+struct ClientResult
+{
+   double dAcceptMicros = 0; //connect() until the ACK for a first ENQ, so the server has accepted and read the connection
+   std::vector<double> AckMicros;
+   unsigned long ulErrors = 0;
+};
+
+static double ElapsedMicros(LoopbackClock::time_point Start)
+{
+   return std::chrono::duration<double, std::micro>(LoopbackClock::now() - Start).count();
+}
+
+static double Percentile(std::vector<double> Samples, double Fraction)
+{
+   if (Samples.empty())
+   {
+      return 0;
+   }
+   std::sort(Samples.begin(), Samples.end());
+   size_t Index = (size_t)(Fraction * (Samples.size() - 1) + 0.5);
+   return Samples[Index];
+}
+
+//Waits for one byte and returns true if it is an ACK
+static bool ReceiveAck(int iSocket)
+{
+   uint8_t Reply = 0;
+   return recv(iSocket, &Reply, 1, 0) == 1 && Reply == ACK_MSG;
+}
+
+static void RunClient(unsigned long ulMessages, unsigned long ulRate, ClientResult &Result)
+{
+   int iSocket = socket(AF_INET, SOCK_STREAM, 0);
+   int iNoDelay = 1;
+   setsockopt(iSocket, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+   timeval Timeout = {LOOPBACK_ACK_TIMEOUT, 0};
+   setsockopt(iSocket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+   sockaddr_in Address = {};
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   Address.sin_port = htons(LOOPBACK_PORT);
+
+   auto Start = LoopbackClock::now();
+   const uint8_t Enq = ENQ_MSG;
+   if (connect(iSocket, (sockaddr *)&Address, sizeof(Address)) < 0 || send(iSocket, &Enq, 1, 0) != 1 || !ReceiveAck(iSocket))
+   {
+      Result.ulErrors += ulMessages + 1;
+      close(iSocket);
+      return;
+   }
+   Result.dAcceptMicros = ElapsedMicros(Start);
+
+   //Messages are paced at a fixed rate, like the timing system streaming running times
+   auto Interval = std::chrono::microseconds(1000000 / ulRate);
+   auto NextSend = LoopbackClock::now();
+   for (unsigned long i = 0; i < ulMessages; i++)
+   {
+      std::this_thread::sleep_until(NextSend);
+      NextSend += Interval;
+
+      char szMessage[8];
+      int iLength = snprintf(szMessage, sizeof(szMessage), "%04lu\n", i % 10000);
+      auto SendTime = LoopbackClock::now();
+      if (send(iSocket, szMessage, iLength, MSG_NOSIGNAL) != iLength || !ReceiveAck(iSocket))
+      {
+         Result.ulErrors++;
+         continue;
+      }
+      Result.AckMicros.push_back(ElapsedMicros(SendTime));
+   }
+   close(iSocket);
+}
+
+//Sends every update followed by a duplicate, a packet for another group and a late packet, only the update may be accepted
+static void RunUdpSender(unsigned long ulMessages, unsigned long ulRate)
+{
+   int iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+   sockaddr_in Address = {};
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   Address.sin_port = htons(LOOPBACK_UDP_PORT);
+
+   auto Interval = std::chrono::microseconds(1000000 / ulRate);
+   auto NextSend = LoopbackClock::now();
+   for (unsigned long i = 0; i < ulMessages; i++)
+   {
+      std::this_thread::sleep_until(NextSend);
+      NextSend += Interval;
+
+      uint16_t iSequence = i + 1;
+      uint8_t iGroup = i % 2 ? LOOPBACK_UDP_GROUP : UDP_BROADCAST_GROUP;
+      char szPackets[4][32];
+      snprintf(szPackets[0], sizeof(szPackets[0]), "%u:%u:%04lu\n", iGroup, iSequence, i % 10000);
+      strcpy(szPackets[1], szPackets[0]);
+      snprintf(szPackets[2], sizeof(szPackets[2]), "%u:%u:CLR\n", LOOPBACK_UDP_GROUP + 1, (uint16_t)(iSequence + 1));
+      snprintf(szPackets[3], sizeof(szPackets[3]), "%u:%u:CLR\n", UDP_BROADCAST_GROUP, (uint16_t)(iSequence - 1));
+      for (auto &szPacket : szPackets)
+      {
+         sendto(iSocket, szPacket, strlen(szPacket), 0, (sockaddr *)&Address, sizeof(Address));
+      }
+   }
+   close(iSocket);
+}
+
+//Messages are only counted by the listener's stats, like on the display UDP is never answered
+static void DrainUdp(UdpListener<PosixTransport> &Listener, QueuedMessage &Message)
+{
+   while (Listener.GetMessage(Message))
+   {
+   }
+}
+
+//Reads the optional argument iArg as a decimal count, false if it is there but not a plain number
+static bool ParseCount(int argc, char **argv, int iArg, unsigned long &ulCount)
+{
+   if (argc <= iArg)
+   {
+      return true;
+   }
+   char *szEnd;
+   errno = 0;
+   ulCount = strtoul(argv[iArg], &szEnd, 10);
+   return isdigit((unsigned char)argv[iArg][0]) && *szEnd == '\0' && errno == 0;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned long ulClients = 8;
+   unsigned long ulMessages = 500;
+   unsigned long ulRate = 100;
+   if (argc > 4 || !ParseCount(argc, argv, 1, ulClients) || !ParseCount(argc, argv, 2, ulMessages) ||
+       !ParseCount(argc, argv, 3, ulRate) || ulClients > 1000 || ulRate < 1)
+   {
+      printf("usage: %s [clients] [messages per client] [messages/s per client]\r\n", argv[0]);
+      printf("  clients              client threads, 0 only runs the server (8, at most 1000)\r\n");
+      printf("  messages per client  messages each client sends (500)\r\n");
+      printf("  messages/s           send rate of each client, at least 1 (100)\r\n");
+      return 1;
+   }
+   int iClients = (int)ulClients;
+
+   PosixServer Server(LOOPBACK_PORT);
+   NetworkServer<PosixTransport, LOOPBACK_SLOTS> MessageServer;
+   if (!Server.begin())
+   {
+      printf("Can't listen on port %i\r\n", LOOPBACK_PORT);
+      return 1;
+   }
+   MessageServer.init(&Server);
+   UdpListener<PosixTransport> UpdateListener;
+   if (!UpdateListener.begin(LOOPBACK_UDP_PORT, LOOPBACK_UDP_GROUP))
+   {
+      printf("Can't listen on UDP port %i\r\n", LOOPBACK_UDP_PORT);
+      return 1;
+   }
+
+   std::vector<ClientResult> Results(iClients);
+   std::vector<std::thread> Threads;
+   std::atomic<int> iFinished(0);
+   auto Start = LoopbackClock::now();
+   for (auto &Result : Results)
+   {
+      Threads.emplace_back([&]() {
+         RunClient(ulMessages, ulRate, Result);
+         iFinished++;
+      });
+   }
+   if (iClients > 0)
+   {
+      Threads.emplace_back([&]() {
+         RunUdpSender(ulMessages, ulRate);
+         iFinished++;
+      });
+   }
+
+   if (iClients == 0)
+   {
+      printf("Serving on port %i with %i slots, UDP group %i on port %i, stop with Ctrl-C\r\n", LOOPBACK_PORT, LOOPBACK_SLOTS,
+             LOOPBACK_UDP_GROUP, LOOPBACK_UDP_PORT);
+   }
+
+   //The server side is single threaded, exactly like loop() on the display
+   unsigned long ulReceived = 0, ulLoops = 0;
+   QueuedMessage Message;
+   while (iClients == 0 || iFinished < iClients + 1)
+   {
+      Server.wait(1);
+      MessageServer.Loop();
+      while (MessageServer.GetMessage(Message))
+      {
+         //Commands are only checked, not executed, so sequenced clients get the same ACK/NAK as from a display
+         ParsedCommand Command;
+         bool bValid = Message.Type == MESSAGE_BINARY ? ValidateBinaryOps((const uint8_t *)Message.szData, Message.iLength)
+                                                      : ParseCommand(Message.szData, Command);
+         MessageServer.Reply(Message, bValid);
+         ulReceived++;
+      }
+      DrainUdp(UpdateListener, Message);
+      Log.Loop();
+      ulLoops++;
+   }
+   double dSeconds = ElapsedMicros(Start) / 1000000;
+   for (auto &Thread : Threads)
+   {
+      Thread.join();
+   }
+   //Packets of the last round may still be in the socket
+   Server.wait(10);
+   DrainUdp(UpdateListener, Message);
+
+   std::vector<double> AcceptTimes, AckTimes;
+   unsigned long ulErrors = 0;
+   for (auto &Result : Results)
+   {
+      if (Result.dAcceptMicros > 0)
+      {
+         AcceptTimes.push_back(Result.dAcceptMicros);
+      }
+      AckTimes.insert(AckTimes.end(), Result.AckMicros.begin(), Result.AckMicros.end());
+      ulErrors += Result.ulErrors;
+   }
+
+   printf("WifiNumericDisplay loopback test: %i clients x %lu messages at %lu/s, %i slots\r\n", iClients, ulMessages, ulRate, LOOPBACK_SLOTS);
+   printf("accept:     p50 %.0f us | p99 %.0f us | max %.0f us (%zu of %i clients served)\r\n", Percentile(AcceptTimes, 0.5),
+          Percentile(AcceptTimes, 0.99), Percentile(AcceptTimes, 1.0), AcceptTimes.size(), iClients);
+   printf("ACK:        p50 %.0f us | p99 %.0f us | max %.0f us\r\n", Percentile(AckTimes, 0.5), Percentile(AckTimes, 0.99),
+          Percentile(AckTimes, 1.0));
+   printf("throughput: %.0f messages/s handled | %.0f server loops/s | %lu errors\r\n", ulReceived / dSeconds, ulLoops / dSeconds, ulErrors);
+
+   const UdpListenerStats &Stats = UpdateListener.GetStats();
+   bool bUdpFailed = Stats.ulAccepted != ulMessages || Stats.ulStale != 2 * ulMessages || Stats.ulOtherGroup != ulMessages || Stats.ulInvalid > 0;
+   printf("udp:        %lu updates: %lu accepted | %lu stale | %lu other group | %lu invalid%s\r\n", ulMessages, Stats.ulAccepted, Stats.ulStale,
+          Stats.ulOtherGroup, Stats.ulInvalid, bUdpFailed ? " | MISMATCH" : "");
+   if (bUdpFailed)
+   {
+      ulErrors++;
+   }
+   return ulErrors > 0;
+}
@@ -0,0 +1,172 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BinaryFrame.h"
+#include <string.h>
+
+#define BINARY_NUMBER_MIN_VALUE -999
+#define BINARY_NUMBER_MAX_VALUE 9999
+#define BINARY_MAX_DECIMALS 3
+#define BINARY_MAX_COUNTDOWN 9999
+#define BINARY_NUM_DIGITS 4
+
+BinaryFrameResult BinaryFrameReader::Push(uint8_t Byte)
+{
+   switch (_State)
+   {
+   case _STATE_IDLE:
+      if (Byte == BINARY_FRAME_START)
+      {
+         _State = _STATE_VERSION;
+      }
+      return BINARY_FRAME_INCOMPLETE;
+
+   case _STATE_VERSION:
+      if (Byte != BINARY_FRAME_VERSION)
+      {
+         _State = _STATE_IDLE;
+         return BINARY_FRAME_BAD_HEADER;
+      }
+      _Sum = Byte;
+      _State = _STATE_LENGTH;
+      return BINARY_FRAME_INCOMPLETE;
+
+   case _STATE_LENGTH:
+      if (Byte == 0 || Byte > BINARY_FRAME_MAX_BODY)
+      {
+         _State = _STATE_IDLE;
+         return BINARY_FRAME_BAD_HEADER;
+      }
+      _Length = Byte;
+      _Received = 0;
+      _Sum += Byte;
+      _State = _STATE_BODY;
+      return BINARY_FRAME_INCOMPLETE;
+
+   case _STATE_BODY:
+      _Body[_Received++] = Byte;
+      _Sum += Byte;
+      if (_Received == _Length)
+      {
+         _State = _STATE_CHECKSUM;
+      }
+      return BINARY_FRAME_INCOMPLETE;
+
+   default:
+      _State = _STATE_IDLE;
+      return (uint8_t)(_Sum + Byte) == 0 ? BINARY_FRAME_COMPLETE : BINARY_FRAME_ERROR;
+   }
+}
+
+bool BinaryOpReader::Next(BinaryOp &Op)
+{
+   if (_bError || _Position >= _Length)
+   {
+      return false;
+   }
+
+   const uint8_t *p = _Body + _Position;
+   uint8_t Remaining = _Length - _Position;
+   uint8_t iOpLength = 1;
+   Op.Opcode = (BinaryOpcode)p[0];
+   switch (Op.Opcode)
+   {
+   case BINARY_OP_SET_NUMBER:
+      iOpLength = 4;
+      if (Remaining < iOpLength)
+      {
+         break;
+      }
+      Op.lValue = (int16_t)((p[1] << 8) | p[2]);
+      Op.iDecimals = p[3];
+      if (Op.lValue < BINARY_NUMBER_MIN_VALUE || Op.lValue > BINARY_NUMBER_MAX_VALUE || Op.iDecimals > BINARY_MAX_DECIMALS)
+      {
+         iOpLength = 0;
+      }
+      break;
+
+   case BINARY_OP_COUNTDOWN:
+      iOpLength = 3;
+      if (Remaining < iOpLength)
+      {
+         break;
+      }
+      Op.lValue = (p[1] << 8) | p[2];
+      if (Op.lValue > BINARY_MAX_COUNTDOWN)
+      {
+         iOpLength = 0;
+      }
+      break;
+
+   case BINARY_OP_CLEAR:
+      break;
+
+   case BINARY_OP_SEGMENTS:
+      if (Remaining < 3)
+      {
+         iOpLength = 3;
+         break;
+      }
+      Op.iPosition = p[1];
+      Op.iCount = p[2];
+      Op.Segments = p + 3;
+      iOpLength = 3 + Op.iCount;
+      if (Op.iCount == 0 || Op.iPosition + Op.iCount > BINARY_NUM_DIGITS)
+      {
+         iOpLength = 0;
+      }
+      break;
+
+   default:
+      iOpLength = 0;
+      break;
+   }
+
+   if (iOpLength == 0 || Remaining < iOpLength)
+   {
+      _bError = true;
+      return false;
+   }
+   _Position += iOpLength;
+   return true;
+}
+
+bool ValidateBinaryOps(const uint8_t *Body, uint8_t Length)
+{
+   BinaryOpReader Reader(Body, Length);
+   BinaryOp Op;
+   while (Reader.Next(Op))
+   {
+   }
+   return Length > 0 && Reader.AtValidEnd();
+}
+
+size_t BuildBinaryFrame(const uint8_t *Body, uint8_t Length, uint8_t *Frame)
+{
+   uint8_t Sum = BINARY_FRAME_VERSION + Length;
+   Frame[0] = BINARY_FRAME_START;
+   Frame[1] = BINARY_FRAME_VERSION;
+   Frame[2] = Length;
+   for (uint8_t i = 0; i < Length; i++)
+   {
+      Frame[3 + i] = Body[i];
+      Sum += Body[i];
+   }
+   Frame[3 + Length] = (uint8_t)(0 - Sum);
+   return Length + BINARY_FRAME_OVERHEAD;
+}
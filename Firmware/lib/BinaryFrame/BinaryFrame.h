@@ -0,0 +1,123 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Binary frames on port 23, next to the text protocol:
+//
+//   STX | version | length | body (length bytes) | checksum
+//
+//STX (0x02) can only start a frame at a message boundary, text messages never contain it.
+//The checksum makes the 8 bit sum of version, length, body and checksum 0.
+//The body holds one or more ops, which are applied together as a single display update:
+//
+//   BINARY_OP_SET_NUMBER  value (int16, big endian), decimals (0-3)
+//   BINARY_OP_COUNTDOWN   seconds (uint16, big endian)
+//   BINARY_OP_CLEAR
+//   BINARY_OP_SEGMENTS    position, count, count bytes of raw segments (SEG_A..SEG_DP bits from SegmentFont.h)
+
+#ifndef _BinaryFrame_h
+#define _BinaryFrame_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BINARY_FRAME_START 0x02
+#define BINARY_FRAME_VERSION 1
+#define BINARY_FRAME_MAX_BODY 32
+#define BINARY_FRAME_OVERHEAD 4 //STX, version, length and checksum
+
+enum BinaryOpcode : uint8_t
+{
+   BINARY_OP_SET_NUMBER = 0x01,
+   BINARY_OP_COUNTDOWN = 0x02,
+   BINARY_OP_CLEAR = 0x03,
+   BINARY_OP_SEGMENTS = 0x04,
+};
+
+enum BinaryFrameResult : uint8_t
+{
+   BINARY_FRAME_INCOMPLETE,
+   BINARY_FRAME_COMPLETE,
+   BINARY_FRAME_ERROR,      //Bad checksum, the frame is dropped
+   BINARY_FRAME_BAD_HEADER, //Bad version or length, the frame is dropped and where it ends is unknown
+};
+
+//One decoded op, only the fields of its opcode are set
+struct BinaryOp
+{
+   BinaryOpcode Opcode;
+   long lValue;       //SET_NUMBER value, COUNTDOWN seconds
+   uint8_t iDecimals; //SET_NUMBER
+   uint8_t iPosition; //SEGMENTS
+   uint8_t iCount;    //SEGMENTS
+   const uint8_t *Segments;
+};
+
+//Collects one frame from a byte stream
+class BinaryFrameReader
+{
+public:
+   //Feed bytes starting with BINARY_FRAME_START, after COMPLETE or ERROR the reader is ready for the next frame
+   BinaryFrameResult Push(uint8_t Byte);
+   //True while a frame has been started but not finished
+   bool IsActive() const { return _State != _STATE_IDLE; }
+   void Reset() { _State = _STATE_IDLE; }
+
+   //Body of the last complete frame
+   const uint8_t *Body() const { return _Body; }
+   uint8_t BodyLength() const { return _Length; }
+
+private:
+   enum : uint8_t
+   {
+      _STATE_IDLE,
+      _STATE_VERSION,
+      _STATE_LENGTH,
+      _STATE_BODY,
+      _STATE_CHECKSUM,
+   };
+   uint8_t _State = _STATE_IDLE;
+   uint8_t _Length = 0;
+   uint8_t _Received = 0;
+   uint8_t _Sum = 0;
+   uint8_t _Body[BINARY_FRAME_MAX_BODY];
+};
+
+//Walks the ops in a frame body
+class BinaryOpReader
+{
+public:
+   BinaryOpReader(const uint8_t *Body, uint8_t Length) : _Body(Body), _Length(Length) {}
+   //Returns false at the end of the body, or at an op which is unknown, truncated or out of range
+   bool Next(BinaryOp &Op);
+   //True if every op up to now was valid and the whole body was used
+   bool AtValidEnd() const { return !_bError && _Position == _Length; }
+
+private:
+   const uint8_t *_Body;
+   uint8_t _Length;
+   uint8_t _Position = 0;
+   bool _bError = false;
+};
+
+//Returns true if the body holds at least one op and all of them are valid
+bool ValidateBinaryOps(const uint8_t *Body, uint8_t Length);
+
+//Wraps a body in a frame, Frame must hold Length + BINARY_FRAME_OVERHEAD bytes. Returns the frame length.
+size_t BuildBinaryFrame(const uint8_t *Body, uint8_t Length, uint8_t *Frame);
+
+#endif
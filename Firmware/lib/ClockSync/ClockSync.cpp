@@ -0,0 +1,64 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClockSync.h"
+
+void ClockSync::Request(uint32_t HostSend, uint32_t DisplayReceive, uint32_t DisplaySend)
+{
+   _PendingTimes[0] = HostSend;
+   _PendingTimes[1] = DisplayReceive;
+   _PendingTimes[2] = DisplaySend;
+   _bPending = true;
+}
+
+bool ClockSync::Complete(uint32_t HostSend, uint32_t HostReceive)
+{
+   if (!_bPending || HostSend != _PendingTimes[0])
+   {
+      return false;
+   }
+   _bPending = false;
+
+   //Round trip minus the time the display held the request, all differences wrap correctly in 32 bits
+   int32_t RoundTrip = (int32_t)(HostReceive - HostSend) - (int32_t)(_PendingTimes[2] - _PendingTimes[1]);
+   if (RoundTrip < 0)
+   {
+      return false;
+   }
+   //((t2 - t1) + (t3 - t4)) / 2 without overflow: (t3 - t4) is (t2 - t1) minus the round trip
+   _Sample &Sample = _Samples[_iNextSample];
+   Sample.Offset = (int32_t)(_PendingTimes[1] - HostSend) - RoundTrip / 2;
+   Sample.RoundTrip = RoundTrip;
+   _iNextSample = (_iNextSample + 1) % CLOCK_SYNC_SAMPLES;
+   if (_iSampleCount < CLOCK_SYNC_SAMPLES)
+   {
+      _iSampleCount++;
+   }
+
+   const _Sample *Best = &_Samples[0];
+   for (uint8_t i = 1; i < _iSampleCount; i++)
+   {
+      if (_Samples[i].RoundTrip < Best->RoundTrip)
+      {
+         Best = &_Samples[i];
+      }
+   }
+   _Offset = Best->Offset;
+   _RoundTrip = Best->RoundTrip;
+   return true;
+}
@@ -0,0 +1,68 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Estimates the offset between a host's clock and micros() from NTP-style exchanges over a display connection:
+//
+//   host -> display   TS<t1>         t1: host time the request was sent
+//   display -> host   T<t1>,<t2>,<t3> t2: micros() when the request arrived, t3: micros() when the answer was sent
+//   host -> display   TSR<t1>,<t4>   t4: host time the answer arrived
+//
+//All times are in microseconds and wrap at 32 bits. Network delay is rarely symmetric, so of the last
+//CLOCK_SYNC_SAMPLES exchanges the one with the shortest round trip is used, its error is at most half its round trip.
+
+#ifndef _ClockSync_h
+#define _ClockSync_h
+
+#include <stdint.h>
+
+#define CLOCK_SYNC_SAMPLES 8
+
+class ClockSync
+{
+public:
+   //Remembers the display side of an exchange, only the latest one can be completed
+   void Request(uint32_t HostSend, uint32_t DisplayReceive, uint32_t DisplaySend);
+   //Completes the exchange for HostSend, returns false if there is no such exchange or its times make no sense
+   bool Complete(uint32_t HostSend, uint32_t HostReceive);
+
+   bool IsSynced() const { return _iSampleCount > 0; }
+   //Converts a host time to a micros() value
+   uint32_t ToLocal(uint32_t HostTime) const { return HostTime + _Offset; }
+   //micros() minus host time
+   int32_t GetOffset() const { return _Offset; }
+   //Round trip of the exchange the offset comes from
+   uint32_t GetRoundTrip() const { return _RoundTrip; }
+
+private:
+   struct _Sample
+   {
+      int32_t Offset;
+      uint32_t RoundTrip;
+   };
+   _Sample _Samples[CLOCK_SYNC_SAMPLES];
+   uint8_t _iSampleCount = 0;
+   uint8_t _iNextSample = 0;
+
+   bool _bPending = false;
+   uint32_t _PendingTimes[3]; //t1, t2, t3
+
+   int32_t _Offset = 0;
+   uint32_t _RoundTrip = 0;
+};
+
+#endif
@@ -0,0 +1,228 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CommandParser.h"
+#include <Arduino.h>
+
+enum ArgumentType : uint8_t
+{
+   ARGUMENT_NONE,
+   ARGUMENT_NUMBER,
+   ARGUMENT_OPTIONAL_NUMBER, //lValue is 0 without a number
+   ARGUMENT_TIME,
+   ARGUMENT_TIME_PAIR,       //<time>,<time>
+   ARGUMENT_SCHEDULED,       //<time> <command>
+};
+
+struct CommandDefinition
+{
+   const char *szKeyword;
+   CommandType Type;
+   ArgumentType Argument;
+   long lMinValue;
+   long lMaxValue;
+};
+
+//Commands starting with a keyword, plain numbers are handled separately
+static const CommandDefinition Commands[] = {
+    {"CD", COMMAND_COUNTDOWN, ARGUMENT_NUMBER, 0, 9999},
+    {"CLR", COMMAND_CLEAR, ARGUMENT_NONE, 0, 0},
+    {"RSTNW", COMMAND_RESET_NETWORK, ARGUMENT_NONE, 0, 0},
+    {"SW", COMMAND_STOPWATCH_START, ARGUMENT_OPTIONAL_NUMBER, 0, 9999},
+    {"SWS", COMMAND_STOPWATCH_STOP, ARGUMENT_NONE, 0, 0},
+    {"SWF", COMMAND_STOPWATCH_FINAL, ARGUMENT_NUMBER, 0, 999999},
+    {"TS", COMMAND_TIME_SYNC, ARGUMENT_TIME, 0, 0},
+    {"TSR", COMMAND_TIME_SYNC_RESULT, ARGUMENT_TIME_PAIR, 0, 0},
+    {"AT", COMMAND_SCHEDULED, ARGUMENT_SCHEDULED, 0, 0},
+    {"STATS", COMMAND_STATS, ARGUMENT_NONE, 0, 0},
+};
+
+#define NUMBER_MIN_VALUE -999
+#define NUMBER_MAX_VALUE 9999
+#define NUMBER_MAX_DIGITS 6 //More digits than this can never be in range, stops overflow
+#define TIME_MAX_DIGITS 10  //32 bit
+
+static bool IsTrailingSpace(char c)
+{
+   return c == '\r' || c == ' ' || c == '\t';
+}
+
+//Parses an optionally negative decimal number that must run up to the end of the message
+static bool ParseNumber(const char *p, long lMinValue, long lMaxValue, long &lValue)
+{
+   bool bNegative = false;
+   if (*p == '-')
+   {
+      bNegative = true;
+      p++;
+   }
+
+   uint8_t iDigits = 0;
+   long lResult = 0;
+   while (*p >= '0' && *p <= '9')
+   {
+      if (++iDigits > NUMBER_MAX_DIGITS)
+      {
+         return false;
+      }
+      lResult = lResult * 10 + (*p - '0');
+      p++;
+   }
+   while (IsTrailingSpace(*p))
+   {
+      p++;
+   }
+   if (iDigits == 0 || *p != '\0')
+   {
+      return false;
+   }
+
+   lValue = bNegative ? -lResult : lResult;
+   return lValue >= lMinValue && lValue <= lMaxValue;
+}
+
+//Parses an unsigned 32 bit decimal time, returns a pointer behind it or NULL if it is invalid
+static const char *ParseTime(const char *p, unsigned long &ulTime)
+{
+   uint64_t ullResult = 0;
+   uint8_t iDigits = 0;
+   while (*p >= '0' && *p <= '9')
+   {
+      if (++iDigits > TIME_MAX_DIGITS)
+      {
+         return NULL;
+      }
+      ullResult = ullResult * 10 + (*p - '0');
+      p++;
+   }
+   if (iDigits == 0 || ullResult > 0xFFFFFFFF)
+   {
+      return NULL;
+   }
+   ulTime = ullResult;
+   return p;
+}
+
+static bool IsSchedulable(CommandType Type)
+{
+   return Type == COMMAND_NUMBER || Type == COMMAND_COUNTDOWN || Type == COMMAND_CLEAR || Type == COMMAND_STOPWATCH_START ||
+          Type == COMMAND_STOPWATCH_STOP || Type == COMMAND_STOPWATCH_FINAL;
+}
+
+static bool ParseTimeArgument(const char *p, ArgumentType Argument, ParsedCommand &Command)
+{
+   p = ParseTime(p, Command.ulTime);
+   if (p == NULL)
+   {
+      return false;
+   }
+   if (Argument == ARGUMENT_TIME_PAIR)
+   {
+      if (*p != ',' || (p = ParseTime(p + 1, Command.ulTime2)) == NULL)
+      {
+         return false;
+      }
+   }
+   else if (Argument == ARGUMENT_SCHEDULED)
+   {
+      ParsedCommand Scheduled;
+      if (*p != ' ' || !ParseCommand(p + 1, Scheduled) || !IsSchedulable(Scheduled.Type))
+      {
+         return false;
+      }
+      Command.szScheduled = p + 1;
+      return true;
+   }
+   while (IsTrailingSpace(*p))
+   {
+      p++;
+   }
+   return *p == '\0';
+}
+
+bool ParseCommand(const char *szMessage, ParsedCommand &Command)
+{
+   Command.Type = COMMAND_INVALID;
+   Command.lValue = 0;
+   Command.ulTime = 0;
+   Command.ulTime2 = 0;
+   Command.szScheduled = NULL;
+
+   const char *p = szMessage;
+   if (*p == '-' || (*p >= '0' && *p <= '9'))
+   {
+      if (!ParseNumber(p, NUMBER_MIN_VALUE, NUMBER_MAX_VALUE, Command.lValue))
+      {
+         return false;
+      }
+      Command.Type = COMMAND_NUMBER;
+      return true;
+   }
+
+   //Keyword is the leading run of upper case letters
+   const char *szKeywordEnd = p;
+   while (*szKeywordEnd >= 'A' && *szKeywordEnd <= 'Z')
+   {
+      szKeywordEnd++;
+   }
+   size_t KeywordLength = szKeywordEnd - p;
+
+   for (auto &Definition : Commands)
+   {
+      if (strlen(Definition.szKeyword) != KeywordLength || strncmp(Definition.szKeyword, p, KeywordLength) != 0)
+      {
+         continue;
+      }
+
+      const char *szArgument = szKeywordEnd;
+      if (Definition.Argument == ARGUMENT_TIME || Definition.Argument == ARGUMENT_TIME_PAIR || Definition.Argument == ARGUMENT_SCHEDULED)
+      {
+         if (!ParseTimeArgument(szArgument, Definition.Argument, Command))
+         {
+            return false;
+         }
+         Command.Type = Definition.Type;
+         return true;
+      }
+
+      bool bNumber = Definition.Argument == ARGUMENT_NUMBER ||
+                     (Definition.Argument == ARGUMENT_OPTIONAL_NUMBER && *szArgument != '\0' && !IsTrailingSpace(*szArgument));
+      if (bNumber)
+      {
+         if (!ParseNumber(szArgument, Definition.lMinValue, Definition.lMaxValue, Command.lValue))
+         {
+            return false;
+         }
+      }
+      else
+      {
+         while (IsTrailingSpace(*szArgument))
+         {
+            szArgument++;
+         }
+         if (*szArgument != '\0')
+         {
+            return false;
+         }
+      }
+      Command.Type = Definition.Type;
+      return true;
+   }
+
+   return false;
+}
@@ -0,0 +1,56 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CommandParser_h
+#define _CommandParser_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum CommandType : uint8_t
+{
+   COMMAND_INVALID,
+   COMMAND_NUMBER,        //nnnn: show time in hundredths of seconds
+   COMMAND_COUNTDOWN,     //CDnnnn: count down from nnnn seconds
+   COMMAND_CLEAR,         //CLR
+   COMMAND_RESET_NETWORK, //RSTNW
+   COMMAND_STOPWATCH_START, //SW[nnnn]: count up from nnnn hundredths of seconds (default 0)
+   COMMAND_STOPWATCH_STOP,  //SWS: freeze the stopwatch
+   COMMAND_STOPWATCH_FINAL, //SWFnnnnnn: stop the stopwatch and show nnnnnn hundredths of seconds
+   COMMAND_TIME_SYNC,        //TS<t1>: clock sync request, see ClockSync.h
+   COMMAND_TIME_SYNC_RESULT, //TSR<t1>,<t4>: completes a clock sync exchange
+   COMMAND_SCHEDULED,        //AT<time> <command>: run command at host time, in microseconds
+   COMMAND_STATS,            //STATS: answer with the runtime metrics
+};
+
+//Result of parsing one message
+struct ParsedCommand
+{
+   CommandType Type = COMMAND_INVALID;
+   long lValue = 0;
+   unsigned long ulTime = 0;       //TS, TSR and AT, 32 bit host time
+   unsigned long ulTime2 = 0;      //TSR
+   const char *szScheduled = NULL; //AT, the command to run, points into the parsed message
+};
+
+//Parses a message in a single pass without allocating, trailing whitespace (e.g. \r) is ignored.
+//Returns false (and Type COMMAND_INVALID) for unknown commands, garbage such as "12ab" and out of range values.
+//AT only accepts commands that make sense at a set time: numbers, CD, CLR and the stopwatch commands.
+bool ParseCommand(const char *szMessage, ParsedCommand &Command);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ConfigStore.h"
+#include <EEPROM.h>
+
+void CopyConfigString(char *szField, size_t Size, const char *szSource)
+{
+   size_t Length = szSource != NULL ? strnlen(szSource, Size - 1) : 0;
+   memcpy(szField, szSource, Length);
+   memset(szField + Length, 0, Size - Length);
+}
+
+bool ConfigStore::_IsValid(const _Record &Record)
+{
+   return Record.Magic == CONFIG_MAGIC && Record.Version == CONFIG_VERSION && Record.Length == sizeof(DisplayConfig) &&
+          Record.Crc == Crc32(&Record, offsetof(_Record, Crc));
+}
+
+bool ConfigStore::Load(DisplayConfig &Config)
+{
+   _Record Record;
+   EEPROM.begin(CONFIG_EEPROM_SIZE);
+   EEPROM.get(0, Record);
+   EEPROM.end();
+
+   if (!_IsValid(Record))
+   {
+      return false;
+   }
+   _ConfigCrc = Crc32(&Record.Config, sizeof(DisplayConfig));
+   _bLoaded = true;
+   memcpy(&Config, &Record.Config, sizeof(Config));
+   return true;
+}
+
+bool ConfigStore::Save(const DisplayConfig &Config)
+{
+   uint32_t ConfigCrc = Crc32(&Config, sizeof(Config));
+   if (_bLoaded && ConfigCrc == _ConfigCrc)
+   {
+      return true;
+   }
+
+   _Record Record;
+   memset(&Record, 0, sizeof(Record));
+   Record.Magic = CONFIG_MAGIC;
+   Record.Version = CONFIG_VERSION;
+   Record.Length = sizeof(DisplayConfig);
+   memcpy(&Record.Config, &Config, sizeof(Config));
+   Record.Crc = Crc32(&Record, offsetof(_Record, Crc));
+
+   EEPROM.begin(CONFIG_EEPROM_SIZE);
+   EEPROM.put(0, Record);
+   bool bCommitted = EEPROM.end();
+   if (bCommitted)
+   {
+      _bLoaded = true;
+      _ConfigCrc = ConfigCrc;
+      _ulWrites++;
+   }
+   return bCommitted;
+}
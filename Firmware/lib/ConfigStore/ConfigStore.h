@@ -0,0 +1,78 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Display configuration as one packed, versioned record in the EEPROM sector, loaded without parsing anything.
+//The record carries a CRC-32, a record that is damaged or from another firmware version is ignored and the defaults
+//are used. The EEPROM emulation erases and rewrites its whole flash sector on every commit, so a write cut off by a
+//reset loses the record, and each Save() costs a sector erase. Save() doesn't write a record that is already stored,
+//callers have to limit how often the config changes.
+
+#ifndef _ConfigStore_h
+#define _ConfigStore_h
+
+#include <Arduino.h>
+#include <DisplayState.h>
+
+#define CONFIG_MAGIC 0x434E4457 //"WDNC"
+#define CONFIG_VERSION 1        //Change when DisplayConfig changes, older records are then ignored
+#define CONFIG_EEPROM_SIZE 256  //Bytes of the EEPROM sector mapped to RAM while loading or saving
+#define CONFIG_IP_SIZE 16       //"255.255.255.255" and the terminator
+#define CONFIG_HOSTNAME_SIZE 33 //DHCP host names are at most 32 characters
+
+struct DisplayConfig
+{
+   char szStaticIp[CONFIG_IP_SIZE]; //Empty for DHCP
+   char szGateway[CONFIG_IP_SIZE];
+   char szSubnet[CONFIG_IP_SIZE];
+   char szHostname[CONFIG_HOSTNAME_SIZE]; //Empty for the default ESP_xxxxxx
+   uint8_t iGroup;                        //UDP display group, see UdpListener.h
+   uint8_t bLastStateValid;
+   DisplayState LastState; //What was shown the last time it stayed the same for a while, for a power up
+} __attribute__((packed));
+
+//Copies szSource to a char[Size] field, cut off to fit and always terminated
+void CopyConfigString(char *szField, size_t Size, const char *szSource);
+
+class ConfigStore
+{
+public:
+   //Reads the stored record, returns false if there is no valid one and leaves Config as it was
+   bool Load(DisplayConfig &Config);
+   //Writes Config unless it is already stored, returns false if the commit failed
+   bool Save(const DisplayConfig &Config);
+   unsigned long GetWriteCount() const { return _ulWrites; }
+
+private:
+   struct _Record
+   {
+      uint32_t Magic;
+      uint16_t Version;
+      uint16_t Length; //sizeof(DisplayConfig)
+      DisplayConfig Config;
+      uint32_t Crc; //Over everything before it
+   } __attribute__((packed));
+   static_assert(sizeof(_Record) <= CONFIG_EEPROM_SIZE, "The record must fit in the mapped part of the sector");
+
+   bool _bLoaded = false;
+   uint32_t _ConfigCrc = 0; //Of the stored config, to skip writing the same config again
+   unsigned long _ulWrites = 0;
+
+   static bool _IsValid(const _Record &Record);
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DisplayDriver.h"
+#include <SegmentFont.h>
+#include <Log.h>
+
+void DisplayDriver::init(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin)
+{
+   _Output.begin(DataPin, ClockPin, LatchPin);
+
+   //Whatever the registers hold after power up is unknown, so the first commit always shifts
+   _bShownFrameValid = false;
+   Clear();
+}
+
+void DisplayDriver::Clear()
+{
+   memset(_Frame, 0, sizeof(_Frame));
+}
+
+void DisplayDriver::SetNumber(long lValue, uint8_t iNumDecimals)
+{
+   uint8_t iNumDigits = DISPLAY_NUM_DIGITS;
+   bool bNegative = false;
+
+   if (lValue < 0)
+   {
+      //Leftmost digit is reserved for the minus sign
+      bNegative = true;
+      iNumDigits--;
+      lValue = -lValue;
+   }
+
+   //Fill from the right
+   for (uint8_t x = 0; x < iNumDigits; x++)
+   {
+      uint8_t iPosition = DISPLAY_NUM_DIGITS - 1 - x;
+      if (lValue == 0 && x > iNumDecimals)
+      {
+         //Don't display prefix zeroes
+         SetDigit(iPosition, ' ', false);
+      }
+      else
+      {
+         SetDigit(iPosition, lValue % 10, (x == iNumDecimals && iNumDecimals > 0));
+      }
+      lValue /= 10;
+   }
+   if (bNegative)
+   {
+      SetDigit(0, '-', false);
+   }
+}
+
+void DisplayDriver::SetDigit(uint8_t iPosition, uint8_t Character, bool bDecimalPoint)
+{
+   SetSegments(iPosition, SegmentGlyph(Character) | (bDecimalPoint ? SEGMENT_DECIMAL_POINT : 0));
+}
+
+void DisplayDriver::SetSegments(uint8_t iPosition, uint8_t Segments)
+{
+   if (iPosition < DISPLAY_NUM_DIGITS)
+   {
+      _Frame[iPosition] = Segments;
+   }
+}
+
+bool DisplayDriver::Commit()
+{
+   if (_bShownFrameValid && memcmp(_Frame, _ShownFrame, sizeof(_Frame)) == 0)
+   {
+      return false;
+   }
+
+   _ShiftOutFrame();
+   memcpy(_ShownFrame, _Frame, sizeof(_Frame));
+   _bShownFrameValid = true;
+   return true;
+}
+
+void DisplayDriver::Preload(const uint8_t *Frame)
+{
+   memcpy(_PreloadedFrame, Frame, sizeof(_PreloadedFrame));
+   _Shift(_PreloadedFrame);
+   _bPreloaded = true;
+}
+
+void DisplayDriver::LatchPreloaded()
+{
+   if (!_bPreloaded)
+   {
+      _Shift(_PreloadedFrame);
+   }
+   _Output.Latch();
+   _ulLatchCount++;
+   _bPreloaded = false;
+   memcpy(_Frame, _PreloadedFrame, sizeof(_Frame));
+   memcpy(_ShownFrame, _PreloadedFrame, sizeof(_ShownFrame));
+   _bShownFrameValid = true;
+}
+
+void DisplayDriver::_ShiftOutFrame()
+{
+   _Shift(_Frame);
+   _Output.Latch();
+   _ulLatchCount++;
+   _bPreloaded = false;
+}
+
+void DisplayDriver::_Shift(const uint8_t *Frame)
+{
+   //The first byte ends up in the last board of the chain, so send the rightmost digit first
+   uint8_t Bytes[DISPLAY_NUM_DIGITS];
+   for (uint8_t i = 0; i < DISPLAY_NUM_DIGITS; i++)
+   {
+      Bytes[i] = Frame[DISPLAY_NUM_DIGITS - 1 - i];
+      LOG_DEBUG("Writing data to SR: %i\r\n", Bytes[i]);
+   }
+   _Output.Write(Bytes, sizeof(Bytes));
+}
@@ -0,0 +1,86 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _DisplayDriver_h
+#define _DisplayDriver_h
+
+#include <Arduino.h>
+
+#define DISPLAY_NUM_DIGITS 4
+
+#define DISPLAY_OUTPUT_BITBANG 0
+#define DISPLAY_OUTPUT_GPIO 1
+#define DISPLAY_OUTPUT_SPI 2
+
+//Selected with -DDISPLAY_OUTPUT=... in platformio.ini, see SegmentOutput.h
+#ifndef DISPLAY_OUTPUT
+#define DISPLAY_OUTPUT DISPLAY_OUTPUT_BITBANG
+#endif
+
+#include "SegmentOutput.h"
+
+#if DISPLAY_OUTPUT == DISPLAY_OUTPUT_GPIO
+typedef GpioSegmentOutput SegmentOutput;
+#elif DISPLAY_OUTPUT == DISPLAY_OUTPUT_SPI
+typedef SpiSegmentOutput SegmentOutput;
+#else
+typedef BitBangSegmentOutput SegmentOutput;
+#endif
+
+//Drives the chain of TPIC6B595 digit boards from a framebuffer.
+//Set...() calls only change the framebuffer, Commit() shows it with exactly one latch pulse,
+//and only if it differs from what the display is already showing.
+class DisplayDriver
+{
+public:
+   void init(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin);
+
+   void Clear();
+   //Formats a number right aligned, with iNumDecimals digits after the decimal point and without leading zeroes
+   void SetNumber(long lValue, uint8_t iNumDecimals);
+   //Position 0 is the leftmost digit, Character is a digit value (0-9) or a character from SegmentFont.h
+   void SetDigit(uint8_t iPosition, uint8_t Character, bool bDecimalPoint);
+   void SetSegments(uint8_t iPosition, uint8_t Segments);
+
+   //Returns true if the display had to be updated
+   bool Commit();
+
+   //Shifts Frame into the chain without showing it, so LatchPreloaded() only has to pulse the latch.
+   //A Commit() in between overwrites the chain, LatchPreloaded() then shifts Frame in again first.
+   void Preload(const uint8_t *Frame);
+   //Shows the preloaded frame, it also becomes the framebuffer
+   void LatchPreloaded();
+   const uint8_t *GetFrame() const { return _Frame; }
+   //Latch pulses so far, tells a caller whether what it did reached the display
+   unsigned long GetLatchCount() const { return _ulLatchCount; }
+
+private:
+   SegmentOutput _Output;
+
+   uint8_t _Frame[DISPLAY_NUM_DIGITS];
+   uint8_t _ShownFrame[DISPLAY_NUM_DIGITS];
+   bool _bShownFrameValid = false;
+   uint8_t _PreloadedFrame[DISPLAY_NUM_DIGITS];
+   bool _bPreloaded = false; //The chain's shift registers hold _PreloadedFrame
+   unsigned long _ulLatchCount = 0;
+
+   void _ShiftOutFrame();
+   void _Shift(const uint8_t *Frame);
+};
+
+#endif
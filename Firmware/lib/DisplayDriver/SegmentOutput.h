@@ -0,0 +1,152 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SegmentOutput_h
+#define _SegmentOutput_h
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <esp8266_peri.h>
+
+#ifndef DISPLAY_SPI_FREQUENCY
+#define DISPLAY_SPI_FREQUENCY 4000000 //TPIC6B595 is good for 10MHz at 5V, leave margin for long wires
+#endif
+
+//Ways of getting bytes into the TPIC6B595 chain, DisplayDriver uses the one selected with DISPLAY_OUTPUT.
+//Every backend has the same interface: begin(), Write() (MSB first) and Latch().
+
+//Arduino shiftOut(), a digitalWrite() call per bit
+class BitBangSegmentOutput
+{
+public:
+   void begin(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin)
+   {
+      _DataPin = DataPin;
+      _ClockPin = ClockPin;
+      _LatchPin = LatchPin;
+      pinMode(_ClockPin, OUTPUT);
+      pinMode(_DataPin, OUTPUT);
+      pinMode(_LatchPin, OUTPUT);
+      digitalWrite(_ClockPin, LOW);
+      digitalWrite(_DataPin, LOW);
+      digitalWrite(_LatchPin, LOW);
+   }
+
+   void Write(const uint8_t *Data, size_t Length)
+   {
+      for (size_t i = 0; i < Length; i++)
+      {
+         digitalWrite(_ClockPin, LOW);
+         shiftOut(_DataPin, _ClockPin, MSBFIRST, Data[i]);
+      }
+   }
+
+   void Latch()
+   {
+      //Register moves storage register on the rising edge of RCK
+      digitalWrite(_LatchPin, LOW);
+      digitalWrite(_LatchPin, HIGH);
+   }
+
+private:
+   uint8_t _DataPin;
+   uint8_t _ClockPin;
+   uint8_t _LatchPin;
+};
+
+//Direct writes to the GPIO set/clear registers, same pins as the bit bang output (GPIO 0-15 only).
+//The TPIC6B595 needs SRCK and RCK high or low for at least 40ns and SER set up 20ns before the rising SRCK edge.
+//The clock high time here is one GPOS to GPOC store, a few cycles of 12.5ns at 80MHz, which has not been
+//measured on a board yet, so this backend is opt-in (env:d1_mini_pro_gpio) and bit bang stays the default.
+class GpioSegmentOutput
+{
+public:
+   void begin(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin)
+   {
+      _DataMask = 1UL << DataPin;
+      _ClockMask = 1UL << ClockPin;
+      _LatchMask = 1UL << LatchPin;
+      pinMode(ClockPin, OUTPUT);
+      pinMode(DataPin, OUTPUT);
+      pinMode(LatchPin, OUTPUT);
+      GPOC = _ClockMask | _DataMask | _LatchMask;
+   }
+
+   void Write(const uint8_t *Data, size_t Length)
+   {
+      for (size_t i = 0; i < Length; i++)
+      {
+         for (uint8_t Bit = 0x80; Bit != 0; Bit >>= 1)
+         {
+            if (Data[i] & Bit)
+            {
+               GPOS = _DataMask;
+            }
+            else
+            {
+               GPOC = _DataMask;
+            }
+            GPOS = _ClockMask;
+            GPOC = _ClockMask;
+         }
+      }
+   }
+
+   void Latch()
+   {
+      GPOC = _LatchMask;
+      GPOS = _LatchMask;
+   }
+
+private:
+   uint32_t _DataMask;
+   uint32_t _ClockMask;
+   uint32_t _LatchMask;
+};
+
+//Hardware SPI (HSPI). Needs the chain's SER on MOSI (D7) and SRCK on SCK (D5), so the data and clock
+//pins passed to begin() are ignored. The stock board routes D1/D2 and has to be rewired for this backend.
+class SpiSegmentOutput
+{
+public:
+   void begin(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin)
+   {
+      _LatchPin = LatchPin;
+      pinMode(_LatchPin, OUTPUT);
+      digitalWrite(_LatchPin, LOW);
+      SPI.begin();
+   }
+
+   void Write(const uint8_t *Data, size_t Length)
+   {
+      SPI.beginTransaction(SPISettings(DISPLAY_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+      SPI.writeBytes(Data, Length);
+      SPI.endTransaction();
+   }
+
+   void Latch()
+   {
+      digitalWrite(_LatchPin, LOW);
+      digitalWrite(_LatchPin, HIGH);
+   }
+
+private:
+   uint8_t _LatchPin;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DisplayState.h"
+
+//Padded to whole 4 byte blocks, RTC memory is read and written per block
+struct _RtcDisplayState
+{
+   uint32_t Magic;
+   DisplayState State;
+   uint32_t Crc;
+};
+static_assert(sizeof(_RtcDisplayState) % 4 == 0, "RTC memory is accessed in 4 byte blocks");
+
+uint32_t Crc32(const void *Data, size_t Length, uint32_t Crc)
+{
+   const uint8_t *Bytes = (const uint8_t *)Data;
+   Crc = ~Crc;
+   while (Length--)
+   {
+      Crc ^= *Bytes++;
+      for (uint8_t i = 0; i < 8; i++)
+      {
+         Crc = (Crc >> 1) ^ (0xEDB88320 & (0 - (Crc & 1)));
+      }
+   }
+   return ~Crc;
+}
+
+bool LoadRtcDisplayState(DisplayState &State)
+{
+   _RtcDisplayState Record;
+   if (!ESP.rtcUserMemoryRead(DISPLAY_STATE_RTC_OFFSET, (uint32_t *)&Record, sizeof(Record)) || Record.Magic != DISPLAY_STATE_MAGIC ||
+       Record.Crc != Crc32(&Record.State, sizeof(Record.State)))
+   {
+      return false;
+   }
+   State = Record.State;
+   return true;
+}
+
+void SaveRtcDisplayState(const DisplayState &State)
+{
+   _RtcDisplayState Record;
+   memset(&Record, 0, sizeof(Record));
+   Record.Magic = DISPLAY_STATE_MAGIC;
+   Record.State = State;
+   Record.Crc = Crc32(&Record.State, sizeof(Record.State));
+   ESP.rtcUserMemoryWrite(DISPLAY_STATE_RTC_OFFSET, (uint32_t *)&Record, sizeof(Record));
+}
@@ -0,0 +1,53 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//What the display shows, kept in RTC user memory so a reset (brown-out, watchdog, OTA) can put it back on the display
+//within milliseconds, long before WiFi is up. RTC memory survives a reset but not a full power down.
+
+#ifndef _DisplayState_h
+#define _DisplayState_h
+
+#include <Arduino.h>
+#include <DisplayDriver.h>
+
+#define DISPLAY_STATE_RTC_OFFSET 32 //In 4 byte blocks, the first 128 bytes of user RTC memory are used by OTA updates
+#define DISPLAY_STATE_MAGIC 0x44535431 //"DST1", change the last digit when DisplayState changes
+
+enum DisplayStateMode : uint8_t
+{
+   DISPLAY_STATE_STATIC,
+   DISPLAY_STATE_COUNTDOWN,
+   DISPLAY_STATE_STOPWATCH,
+};
+
+struct DisplayState
+{
+   uint8_t Mode;
+   uint8_t bRunning; //Stopwatch only, a stopped stopwatch is restored as its segments
+   uint8_t Segments[DISPLAY_NUM_DIGITS]; //SegmentFont bits of what was shown
+   uint32_t ulValue; //Countdown seconds left or stopwatch hundredths
+};
+
+//CRC-32 (IEEE 802.3), for records that have to survive resets and power loss
+uint32_t Crc32(const void *Data, size_t Length, uint32_t Crc = 0);
+
+//Returns false if RTC memory holds no valid state, e.g. after a power up
+bool LoadRtcDisplayState(DisplayState &State);
+void SaveRtcDisplayState(const DisplayState &State);
+
+#endif
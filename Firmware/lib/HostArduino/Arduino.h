@@ -0,0 +1,243 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake Arduino core used by the [env:native] host build.
+//Only implements what the firmware actually uses, see HostArduino.h for the harness controls.
+
+#ifndef _HostArduino_Arduino_h
+#define _HostArduino_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+//Wemos D1 mini pin mapping
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+#define LED_BUILTIN 2
+
+//Hardware SPI pins
+static const uint8_t SS = 15;
+static const uint8_t MOSI = 13;
+static const uint8_t MISO = 12;
+static const uint8_t SCK = 14;
+
+#define PROGMEM
+#define PSTR(s) ("" s) //Only takes a string literal, like the ESP8266 one
+#define F(s) (s)
+#define vsnprintf_P vsnprintf
+#define snprintf_P snprintf
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+
+void setup();
+void loop();
+
+class String
+{
+public:
+   String() {}
+   String(const char *cstr) : _str(cstr ? cstr : "") {}
+   String(const std::string &str) : _str(str) {}
+   String(char c) : _str(1, c) {}
+   explicit String(int value) : _str(std::to_string(value)) {}
+   explicit String(unsigned int value) : _str(std::to_string(value)) {}
+   explicit String(long value) : _str(std::to_string(value)) {}
+   explicit String(unsigned long value) : _str(std::to_string(value)) {}
+
+   const char *c_str() const { return _str.c_str(); }
+   unsigned int length() const { return _str.length(); }
+   bool equals(const String &other) const { return _str == other._str; }
+   bool operator==(const String &other) const { return _str == other._str; }
+   bool operator==(const char *cstr) const { return _str == cstr; }
+   bool operator!=(const String &other) const { return _str != other._str; }
+   bool operator!=(const char *cstr) const { return _str != cstr; }
+   char operator[](unsigned int index) const { return index < _str.length() ? _str[index] : 0; }
+   char charAt(unsigned int index) const { return (*this)[index]; }
+
+   String &operator+=(const String &other)
+   {
+      _str += other._str;
+      return *this;
+   }
+   String &operator+=(const char *cstr)
+   {
+      _str += cstr;
+      return *this;
+   }
+   String &operator+=(char c)
+   {
+      _str += c;
+      return *this;
+   }
+   friend String operator+(const String &lhs, const String &rhs) { return String(lhs._str + rhs._str); }
+   friend String operator+(const String &lhs, const char *rhs) { return String(lhs._str + rhs); }
+   friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs._str); }
+
+   int indexOf(char c, unsigned int from = 0) const { return _Index(_str.find(c, from)); }
+   int indexOf(const char *cstr, unsigned int from = 0) const { return _Index(_str.find(cstr, from)); }
+   int indexOf(const String &other, unsigned int from = 0) const { return _Index(_str.find(other._str, from)); }
+   int lastIndexOf(char c) const { return _Index(_str.rfind(c)); }
+   String substring(unsigned int from) const { return from < _str.length() ? String(_str.substr(from)) : String(); }
+   String substring(unsigned int from, unsigned int to) const
+   {
+      if (from >= _str.length() || to <= from)
+      {
+         return String();
+      }
+      return String(_str.substr(from, to - from));
+   }
+   long toInt() const { return atol(_str.c_str()); }
+   void trim()
+   {
+      size_t first = _str.find_first_not_of(" \t\r\n");
+      size_t last = _str.find_last_not_of(" \t\r\n");
+      _str = (first == std::string::npos) ? std::string() : _str.substr(first, last - first + 1);
+   }
+
+private:
+   std::string _str;
+   static int _Index(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+class Print
+{
+public:
+   virtual ~Print() {}
+   virtual size_t write(uint8_t c) = 0;
+   virtual size_t write(const uint8_t *buffer, size_t size)
+   {
+      size_t n = 0;
+      while (size--)
+      {
+         n += write(*buffer++);
+      }
+      return n;
+   }
+   size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+   size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+   size_t print(const char *str) { return write(str); }
+   size_t print(const String &str) { return write(str.c_str()); }
+   size_t print(char c) { return write((uint8_t)c); }
+   size_t print(int value) { return printf("%d", value); }
+   size_t print(unsigned int value) { return printf("%u", value); }
+   size_t print(long value) { return printf("%ld", value); }
+   size_t print(unsigned long value) { return printf("%lu", value); }
+   template <typename T, typename = typename std::enable_if<std::is_class<T>::value>::type>
+   size_t print(const T &printable) { return print(printable.toString()); }
+   size_t println() { return write("\r\n"); }
+   size_t println(const char *str) { return print(str) + println(); }
+   size_t println(const String &str) { return print(str) + println(); }
+   size_t println(char c) { return print(c) + println(); }
+   size_t println(int value) { return print(value) + println(); }
+   size_t println(unsigned int value) { return print(value) + println(); }
+   size_t println(long value) { return print(value) + println(); }
+   size_t println(unsigned long value) { return print(value) + println(); }
+   template <typename T, typename = typename std::enable_if<std::is_class<T>::value>::type>
+   size_t println(const T &printable) { return print(printable) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+   virtual int available() = 0;
+   virtual int read() = 0;
+   virtual int peek() = 0;
+   virtual void flush() = 0;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+   void begin(unsigned long baud);
+   int available() override;
+   int read() override;
+   int peek() override;
+   void flush() override;
+   int availableForWrite();
+   size_t write(uint8_t c) override;
+   size_t write(const uint8_t *buffer, size_t size) override;
+   using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+   uint32_t getChipId() { return 0x00C0FFEE; }
+   uint32_t getFlashChipRealSize() { return 4194304; }
+   uint32_t getFlashChipSize() { return 4194304; }
+   uint32_t getFreeHeap();
+   uint32_t getMaxFreeBlockSize();
+   //offset in 4 byte blocks, size in bytes, 512 bytes of user memory that survive a reset
+   bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+   bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+   void reset();
+   void restart();
+   bool eraseConfig() { return true; }
+};
+
+extern EspClass ESP;
+
+#endif
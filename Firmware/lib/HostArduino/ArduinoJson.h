@@ -0,0 +1,132 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Minimal stand-in for ArduinoJson 5 in the host build.
+//Only handles flat objects with string values, which is all config.json contains.
+
+#ifndef _HostArduino_ArduinoJson_h
+#define _HostArduino_ArduinoJson_h
+
+#include "Arduino.h"
+#include <map>
+
+class JsonObject;
+
+class JsonVariant
+{
+public:
+   JsonVariant(JsonObject &Object, const char *Key) : _Object(Object), _Key(Key) {}
+   operator const char *() const;
+   explicit operator bool() const;
+   JsonVariant &operator=(const String &Value);
+   JsonVariant &operator=(const char *Value);
+
+private:
+   JsonObject &_Object;
+   std::string _Key;
+};
+
+class JsonObject
+{
+public:
+   bool success() const { return _bSuccess; }
+   JsonVariant operator[](const char *Key) { return JsonVariant(*this, Key); }
+   size_t printTo(Print &Output) const
+   {
+      size_t n = Output.print("{");
+      bool bFirst = true;
+      for (auto &Member : _Members)
+      {
+         n += Output.printf("%s\"%s\":\"%s\"", bFirst ? "" : ",", Member.first.c_str(), Member.second.c_str());
+         bFirst = false;
+      }
+      return n + Output.print("}");
+   }
+   size_t prettyPrintTo(Print &Output) const { return printTo(Output); }
+
+private:
+   friend class JsonVariant;
+   friend class DynamicJsonBuffer;
+   bool _bSuccess = true;
+   std::map<std::string, std::string> _Members;
+};
+
+inline JsonVariant::operator const char *() const
+{
+   auto Member = _Object._Members.find(_Key);
+   return Member == _Object._Members.end() ? nullptr : Member->second.c_str();
+}
+
+inline JsonVariant::operator bool() const
+{
+   const char *Value = *this;
+   return Value != nullptr && Value[0] != '\0';
+}
+
+inline JsonVariant &JsonVariant::operator=(const String &Value)
+{
+   _Object._Members[_Key] = Value.c_str();
+   return *this;
+}
+
+inline JsonVariant &JsonVariant::operator=(const char *Value)
+{
+   _Object._Members[_Key] = Value;
+   return *this;
+}
+
+class DynamicJsonBuffer
+{
+public:
+   JsonObject &createObject() { return _Object; }
+   JsonObject &parseObject(const char *Json)
+   {
+      //Collect quoted strings and pair them up as key/value
+      std::string Key, Token;
+      bool bInString = false, bHaveKey = false;
+      _Object._bSuccess = (Json != nullptr && *Json == '{');
+      for (const char *p = Json; _Object._bSuccess && *p; p++)
+      {
+         if (*p == '"')
+         {
+            if (bInString && bHaveKey)
+            {
+               _Object._Members[Key] = Token;
+               bHaveKey = false;
+            }
+            else if (bInString)
+            {
+               Key = Token;
+               bHaveKey = true;
+            }
+            bInString = !bInString;
+            Token.clear();
+         }
+         else if (bInString)
+         {
+            Token += *p;
+         }
+      }
+      return _Object;
+   }
+
+private:
+   JsonObject _Object;
+};
+
+#endif
@@ -0,0 +1,51 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake ArduinoOTA for the host build, OTA updates never happen on the host
+
+#ifndef _HostArduino_ArduinoOTA_h
+#define _HostArduino_ArduinoOTA_h
+
+#include "Arduino.h"
+
+typedef enum
+{
+   OTA_AUTH_ERROR,
+   OTA_BEGIN_ERROR,
+   OTA_CONNECT_ERROR,
+   OTA_RECEIVE_ERROR,
+   OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass
+{
+public:
+   void setPort(uint16_t port) {}
+   void setHostname(const char *hostname) {}
+   void setPassword(const char *password) {}
+   void onStart(std::function<void(void)> fn) {}
+   void onEnd(std::function<void(void)> fn) {}
+   void onProgress(std::function<void(unsigned int, unsigned int)> fn) {}
+   void onError(std::function<void(ota_error_t)> fn) {}
+   void begin() {}
+   void handle() {}
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
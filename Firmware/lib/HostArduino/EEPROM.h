@@ -0,0 +1,64 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake EEPROM for the host build, a 4 KB sector that keeps its contents for the whole run like flash would
+
+#ifndef _HostArduino_EEPROM_h
+#define _HostArduino_EEPROM_h
+
+#include "Arduino.h"
+#include <vector>
+
+class EEPROMClass
+{
+public:
+   void begin(size_t size);
+   uint8_t read(int address) const { return (size_t)address < _Data.size() ? _Data[address] : 0; }
+   void write(int address, uint8_t val);
+   bool commit();
+   bool end();
+   size_t length() const { return _Data.size(); }
+
+   template <typename T>
+   T &get(int address, T &t)
+   {
+      if (address >= 0 && address + sizeof(T) <= _Data.size())
+      {
+         memcpy((uint8_t *)&t, _Data.data() + address, sizeof(T));
+      }
+      return t;
+   }
+   template <typename T>
+   const T &put(int address, const T &t)
+   {
+      if (address >= 0 && address + sizeof(T) <= _Data.size())
+      {
+         memcpy(_Data.data() + address, (const uint8_t *)&t, sizeof(T));
+         _bDirty = true;
+      }
+      return t;
+   }
+
+private:
+   std::vector<uint8_t> _Data;
+   bool _bDirty = false;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,93 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake ESP8266WebServer for the host build, requests come in through HostArduino::Connect().
+//Only what the firmware uses: one request per connection, query string arguments, and responses with a length
+//or streamed with sendContent() until the connection is closed.
+
+#ifndef _HostArduino_ESP8266WebServer_h
+#define _HostArduino_ESP8266WebServer_h
+
+#include "ESP8266WiFi.h"
+#include <vector>
+
+enum HTTPMethod
+{
+   HTTP_ANY,
+   HTTP_GET,
+   HTTP_HEAD,
+   HTTP_POST,
+   HTTP_PUT,
+   HTTP_PATCH,
+   HTTP_DELETE,
+   HTTP_OPTIONS
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define HTTP_MAX_DATA_WAIT 5000
+
+class ESP8266WebServer
+{
+public:
+   typedef std::function<void(void)> THandlerFunction;
+
+   ESP8266WebServer(int port = 80) : _Server(port) {}
+   void begin() { _Server.begin(); }
+   void handleClient();
+
+   void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+   void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+   void onNotFound(THandlerFunction handler) { _NotFound = handler; }
+
+   const String &uri() const { return _Uri; }
+   HTTPMethod method() const { return _Method; }
+   String arg(const String &name) const;
+   bool hasArg(const String &name) const;
+
+   void sendHeader(const String &name, const String &value);
+   void setContentLength(size_t contentLength) { _ContentLength = contentLength; }
+   void send(int code, const char *content_type = NULL, const String &content = String());
+   void send_P(int code, const char *content_type, const char *content) { send(code, content_type, String(content)); }
+   void sendContent(const char *content, size_t size);
+   void sendContent(const char *content) { sendContent(content, strlen(content)); }
+
+private:
+   struct _Route
+   {
+      String Uri;
+      HTTPMethod Method;
+      THandlerFunction Handler;
+   };
+
+   WiFiServer _Server;
+   WiFiClient _Client;
+   unsigned long _ulClientTime = 0;
+   std::string _Request;
+   std::vector<_Route> _Routes;
+   THandlerFunction _NotFound;
+
+   String _Uri;
+   HTTPMethod _Method = HTTP_ANY;
+   std::vector<std::pair<std::string, std::string>> _Args;
+   std::string _Headers;
+   size_t _ContentLength = CONTENT_LENGTH_UNKNOWN;
+
+   bool _ParseRequest();
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake ESP8266WiFi for the host build, connections are injected through HostArduino::Connect()
+
+#ifndef _HostArduino_ESP8266WiFi_h
+#define _HostArduino_ESP8266WiFi_h
+
+#include "Arduino.h"
+
+namespace HostArduino
+{
+struct Connection;
+}
+
+typedef enum
+{
+   WL_IDLE_STATUS = 0,
+   WL_NO_SSID_AVAIL = 1,
+   WL_SCAN_COMPLETED = 2,
+   WL_CONNECTED = 3,
+   WL_CONNECT_FAILED = 4,
+   WL_CONNECTION_LOST = 5,
+   WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+   WIFI_OFF = 0,
+   WIFI_STA = 1,
+   WIFI_AP = 2,
+   WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum
+{
+   WIFI_NONE_SLEEP = 0,
+   WIFI_LIGHT_SLEEP = 1,
+   WIFI_MODEM_SLEEP = 2
+} WiFiSleepType_t;
+
+class IPAddress
+{
+public:
+   IPAddress() : _Address{0, 0, 0, 0} {}
+   IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _Address{a, b, c, d} {}
+   bool fromString(const char *address);
+   bool fromString(const String &address) { return fromString(address.c_str()); }
+   String toString() const;
+   uint8_t operator[](int index) const { return _Address[index]; }
+
+private:
+   uint8_t _Address[4];
+};
+
+class WiFiClient : public Stream
+{
+public:
+   WiFiClient() {}
+   explicit WiFiClient(std::shared_ptr<HostArduino::Connection> Conn) : _Conn(Conn) {}
+
+   uint8_t connected();
+   int available() override;
+   int read() override;
+   int read(uint8_t *buffer, size_t size);
+   int peek() override;
+   void flush() override {}
+   void stop();
+   void setNoDelay(bool nodelay);
+   bool getNoDelay();
+   int availableForWrite();
+   size_t write(uint8_t c) override;
+   size_t write(const uint8_t *buffer, size_t size) override;
+   using Print::write;
+   explicit operator bool() { return connected(); }
+
+private:
+   std::shared_ptr<HostArduino::Connection> _Conn;
+};
+
+class WiFiServer
+{
+public:
+   WiFiServer(uint16_t port) : _Port(port) {}
+   void begin();
+   WiFiClient available();
+   void setNoDelay(bool nodelay) { _bNoDelay = nodelay; }
+
+private:
+   uint16_t _Port;
+   bool _bNoDelay = false;
+};
+
+class ESP8266WiFiClass
+{
+public:
+   wl_status_t status();
+   bool mode(WiFiMode_t mode) { return true; }
+   bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet) { return true; }
+   wl_status_t begin() { return status(); }
+   bool setSleepMode(WiFiSleepType_t type) { return true; }
+   String hostname() { return String(_Hostname.c_str()); }
+   bool hostname(const char *aHostname)
+   {
+      _Hostname = aHostname;
+      return true;
+   }
+   String SSID() { return String("HostNetwork"); }
+   IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+   IPAddress gatewayIP() { return IPAddress(127, 0, 0, 254); }
+   IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+
+private:
+   std::string _Hostname = "host-display";
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
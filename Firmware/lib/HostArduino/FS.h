@@ -0,0 +1,81 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake in-memory SPIFFS for the host build
+
+#ifndef _HostArduino_FS_h
+#define _HostArduino_FS_h
+
+#include "Arduino.h"
+#include <map>
+
+class File : public Stream
+{
+public:
+   File() {}
+   File(std::string *Contents, bool bWritable) : _Contents(Contents), _bWritable(bWritable) {}
+
+   size_t size() const { return _Contents ? _Contents->size() : 0; }
+   size_t readBytes(char *buffer, size_t length);
+   int available() override { return _Contents ? (int)(_Contents->size() - _Position) : 0; }
+   int read() override;
+   int peek() override;
+   void flush() override {}
+   size_t write(uint8_t c) override;
+   using Print::write;
+   void close() { _Contents = nullptr; }
+   explicit operator bool() const { return _Contents != nullptr; }
+
+private:
+   std::string *_Contents = nullptr;
+   size_t _Position = 0;
+   bool _bWritable = false;
+};
+
+class FS
+{
+public:
+   bool begin() { return true; }
+   void end() {}
+   bool format()
+   {
+      _Files.clear();
+      return true;
+   }
+   bool exists(const char *path) { return _Files.count(path) > 0; }
+   bool remove(const char *path) { return _Files.erase(path) > 0; }
+   bool rename(const char *pathFrom, const char *pathTo)
+   {
+      auto Entry = _Files.find(pathFrom);
+      if (Entry == _Files.end() || _Files.count(pathTo) > 0)
+      {
+         return false;
+      }
+      _Files[pathTo] = Entry->second;
+      _Files.erase(Entry);
+      return true;
+   }
+   File open(const char *path, const char *mode);
+
+private:
+   std::map<std::string, std::string> _Files;
+};
+
+extern FS SPIFFS;
+
+#endif
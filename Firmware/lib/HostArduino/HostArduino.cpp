@@ -0,0 +1,835 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HostArduino.h"
+#include "FS.h"
+#include "EEPROM.h"
+#include "ArduinoOTA.h"
+#include "ESP8266WebServer.h"
+#include "SPI.h"
+#include "esp8266_peri.h"
+#include <chrono>
+#include <map>
+#include <set>
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+ArduinoOTAClass ArduinoOTA;
+FS SPIFFS;
+
+namespace
+{
+//Virtual time = real time since start + everything skipped through delay()/AdvanceClock()
+const auto StartTime = std::chrono::steady_clock::now();
+uint64_t ullClockOffsetMicros = 0;
+
+uint8_t PinStates[32];
+uint8_t PinInputs[32];
+HostArduino::ShiftRegisterChain SegmentChain;
+uint32_t RtcUserMemory[128];
+std::vector<uint8_t> EepromSector(4096, 0xFF); //Erased flash
+unsigned long ulEepromCommits = 0;
+unsigned long ulWiFiConnectTime = 0;
+
+std::map<uint16_t, std::deque<std::shared_ptr<HostArduino::Connection>>> PendingConnections;
+std::set<uint16_t> ListeningPorts;
+bool bRecordReads = false;
+std::vector<HostArduino::ReadRecord> ReadLog;
+std::map<uint16_t, std::deque<std::vector<uint8_t>>> PendingPackets; //Only ports with a listener have an entry
+
+std::deque<uint8_t> SerialRxData;
+bool bSerialEcho = getenv("HOST_SERIAL_ECHO") != nullptr;
+unsigned long ulSerialBytesWritten = 0;
+
+uint64_t _NowMicros()
+{
+   auto Elapsed = std::chrono::steady_clock::now() - StartTime;
+   return std::chrono::duration_cast<std::chrono::microseconds>(Elapsed).count() + ullClockOffsetMicros;
+}
+} // namespace
+
+/**************************** Time ****************************/
+unsigned long millis()
+{
+   return (unsigned long)(_NowMicros() / 1000);
+}
+
+unsigned long micros()
+{
+   //ESP8266 micros() is 32 bit and rolls over every ~71 minutes
+   return (uint32_t)_NowMicros();
+}
+
+void delay(unsigned long ms)
+{
+   ullClockOffsetMicros += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+   ullClockOffsetMicros += us;
+}
+
+void yield()
+{
+}
+
+/**************************** GPIO ****************************/
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+   uint8_t PrevState = PinStates[pin & 31];
+   PinStates[pin & 31] = val;
+   bool bRisingEdge = PrevState == LOW && val != LOW;
+
+   if (pin == SegmentChain.ClockPin && bRisingEdge)
+   {
+      //SER is shifted into QA on the rising edge of SRCK, QH of each register feeds SER of the next one
+      uint8_t Carry = PinStates[SegmentChain.DataPin & 31] ? 1 : 0;
+      for (auto &Register : SegmentChain.Shifted)
+      {
+         uint8_t Out = Register >> 7;
+         Register = (Register << 1) | Carry;
+         Carry = Out;
+      }
+      SegmentChain.ulBitsShifted++;
+      SegmentChain.CurrentByte = (SegmentChain.CurrentByte << 1) | (PinStates[SegmentChain.DataPin & 31] ? 1 : 0);
+      if (SegmentChain.ulBitsShifted % 8 == 0)
+      {
+         SegmentChain.ulBytesShifted++;
+         if (SegmentChain.bRecordStream)
+         {
+            SegmentChain.Stream.push_back(SegmentChain.CurrentByte);
+         }
+      }
+   }
+   if (pin == SegmentChain.LatchPin && bRisingEdge)
+   {
+      //Storage register is updated on the rising edge of RCK
+      SegmentChain.Latched = SegmentChain.Shifted;
+      SegmentChain.ulLatchCount++;
+      if (SegmentChain.bRecordLatches)
+      {
+         SegmentChain.LatchHistory.push_back(SegmentChain.Latched);
+      }
+      SegmentChain.ulLastLatchMicros = micros();
+   }
+}
+
+int digitalRead(uint8_t pin)
+{
+   return PinInputs[pin & 31];
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+   //Same bit sequence as the ESP8266 core
+   for (uint8_t i = 0; i < 8; i++)
+   {
+      if (bitOrder == LSBFIRST)
+      {
+         digitalWrite(dataPin, !!(val & (1 << i)));
+      }
+      else
+      {
+         digitalWrite(dataPin, !!(val & (1 << (7 - i))));
+      }
+      digitalWrite(clockPin, HIGH);
+      digitalWrite(clockPin, LOW);
+   }
+}
+
+HostGpioRegister &HostGpioRegister::operator=(uint32_t Mask)
+{
+   for (uint8_t Pin = 0; Pin < 16; Pin++)
+   {
+      if (Mask & (1 << Pin))
+      {
+         digitalWrite(Pin, _Value);
+      }
+   }
+   return *this;
+}
+
+HostGpioRegister GPOS(HIGH);
+HostGpioRegister GPOC(LOW);
+
+/**************************** SPI ****************************/
+SPIClass SPI;
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+   //Mode 0, MSB first on the hardware SPI pins
+   shiftOut(MOSI, SCK, MSBFIRST, data);
+   return 0;
+}
+
+void SPIClass::writeBytes(const uint8_t *data, uint32_t size)
+{
+   while (size--)
+   {
+      transfer(*data++);
+   }
+}
+
+/**************************** Serial ****************************/
+size_t Print::printf(const char *format, ...)
+{
+   char Buffer[256];
+   va_list Args;
+   va_start(Args, format);
+   int Length = vsnprintf(Buffer, sizeof(Buffer), format, Args);
+   va_end(Args);
+   if (Length < 0)
+   {
+      return 0;
+   }
+   return write((const uint8_t *)Buffer, std::min((size_t)Length, sizeof(Buffer) - 1));
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+}
+
+int HardwareSerial::available()
+{
+   return SerialRxData.size();
+}
+
+int HardwareSerial::read()
+{
+   if (SerialRxData.empty())
+   {
+      return -1;
+   }
+   uint8_t c = SerialRxData.front();
+   SerialRxData.pop_front();
+   return c;
+}
+
+int HardwareSerial::peek()
+{
+   return SerialRxData.empty() ? -1 : SerialRxData.front();
+}
+
+void HardwareSerial::flush()
+{
+}
+
+int HardwareSerial::availableForWrite()
+{
+   //The host UART never backs up
+   return 128;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+   return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+   ulSerialBytesWritten += size;
+   if (bSerialEcho)
+   {
+      fwrite(buffer, 1, size, stdout);
+   }
+   return size;
+}
+
+/**************************** ESP ****************************/
+uint32_t EspClass::getFreeHeap()
+{
+   return 40000;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize()
+{
+   return 30000;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+   if (offset * 4 + size > sizeof(RtcUserMemory))
+   {
+      return false;
+   }
+   memcpy(data, (uint8_t *)RtcUserMemory + offset * 4, size);
+   return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+   if (offset * 4 + size > sizeof(RtcUserMemory))
+   {
+      return false;
+   }
+   memcpy((uint8_t *)RtcUserMemory + offset * 4, data, size);
+   return true;
+}
+
+//Nothing run on the host expects the firmware to restart, so the exit code reports it as a failure
+void EspClass::reset()
+{
+   printf("ESP.reset() called, exiting host build\r\n");
+   exit(1);
+}
+
+void EspClass::restart()
+{
+   printf("ESP.restart() called, exiting host build\r\n");
+   exit(1);
+}
+
+/**************************** WiFi ****************************/
+bool IPAddress::fromString(const char *address)
+{
+   unsigned int Parts[4];
+   if (sscanf(address, "%u.%u.%u.%u", &Parts[0], &Parts[1], &Parts[2], &Parts[3]) != 4)
+   {
+      return false;
+   }
+   for (int i = 0; i < 4; i++)
+   {
+      _Address[i] = Parts[i];
+   }
+   return true;
+}
+
+String IPAddress::toString() const
+{
+   char Buffer[16];
+   snprintf(Buffer, sizeof(Buffer), "%u.%u.%u.%u", _Address[0], _Address[1], _Address[2], _Address[3]);
+   return String(Buffer);
+}
+
+uint8_t WiFiClient::connected()
+{
+   //Like the real WiFiClient, unread data keeps the client 'connected'
+   return _Conn && _Conn->bLocalOpen && (_Conn->bRemoteOpen || !_Conn->RxData.empty());
+}
+
+int WiFiClient::available()
+{
+   return (_Conn && _Conn->bLocalOpen) ? _Conn->RxData.size() : 0;
+}
+
+int WiFiClient::read()
+{
+   uint8_t c;
+   return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+   if (!_Conn || !_Conn->bLocalOpen)
+   {
+      return -1;
+   }
+   _Conn->ulReadCalls++;
+   size_t n = std::min(size, _Conn->RxData.size());
+   std::copy(_Conn->RxData.begin(), _Conn->RxData.begin() + n, buffer);
+   _Conn->RxData.erase(_Conn->RxData.begin(), _Conn->RxData.begin() + n);
+   for (size_t i = 0; bRecordReads && i < n; i++)
+   {
+      ReadLog.push_back({_Conn.get(), buffer[i]});
+   }
+   return n;
+}
+
+int WiFiClient::peek()
+{
+   return (_Conn && !_Conn->RxData.empty()) ? _Conn->RxData.front() : -1;
+}
+
+void WiFiClient::stop()
+{
+   if (_Conn)
+   {
+      _Conn->bLocalOpen = false;
+   }
+}
+
+void WiFiClient::setNoDelay(bool nodelay)
+{
+   if (_Conn)
+   {
+      _Conn->bNoDelay = nodelay;
+   }
+}
+
+bool WiFiClient::getNoDelay()
+{
+   return _Conn && _Conn->bNoDelay;
+}
+
+int WiFiClient::availableForWrite()
+{
+   return connected() ? _Conn->TxSpace : 0;
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+   return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+   if (!connected())
+   {
+      return 0;
+   }
+   _Conn->TxData.insert(_Conn->TxData.end(), buffer, buffer + size);
+   return size;
+}
+
+void WiFiServer::begin()
+{
+   PendingConnections[_Port];
+   ListeningPorts.insert(_Port);
+}
+
+WiFiClient WiFiServer::available()
+{
+   auto &Pending = PendingConnections[_Port];
+   if (Pending.empty())
+   {
+      return WiFiClient();
+   }
+   auto Conn = Pending.front();
+   Pending.pop_front();
+   Conn->bNoDelay = _bNoDelay;
+   return WiFiClient(Conn);
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+   _Port = port;
+   PendingPackets[_Port];
+   return 1;
+}
+
+int WiFiUDP::parsePacket()
+{
+   _Packet.clear();
+   _Position = 0;
+   auto Pending = PendingPackets.find(_Port);
+   if (_Port == 0 || Pending == PendingPackets.end() || Pending->second.empty())
+   {
+      return 0;
+   }
+   _Packet.swap(Pending->second.front());
+   Pending->second.pop_front();
+   return (int)_Packet.size();
+}
+
+int WiFiUDP::read(unsigned char *buffer, size_t len)
+{
+   size_t n = std::min(len, _Packet.size() - _Position);
+   memcpy(buffer, _Packet.data() + _Position, n);
+   _Position += n;
+   return (int)n;
+}
+
+wl_status_t ESP8266WiFiClass::status()
+{
+   return millis() >= ulWiFiConnectTime ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+/**************************** Web server ****************************/
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler)
+{
+   _Routes.push_back({uri, method, handler});
+}
+
+void ESP8266WebServer::handleClient()
+{
+   if (!_Client.connected())
+   {
+      _Client = _Server.available();
+      if (!_Client.connected())
+      {
+         return;
+      }
+      _ulClientTime = millis();
+      _Request.clear();
+   }
+
+   while (_Client.available() > 0)
+   {
+      _Request += (char)_Client.read();
+   }
+   if (_Request.find("\r\n\r\n") == std::string::npos)
+   {
+      if (millis() - _ulClientTime > HTTP_MAX_DATA_WAIT)
+      {
+         _Client.stop();
+      }
+      return;
+   }
+
+   _Headers.clear();
+   _ContentLength = CONTENT_LENGTH_UNKNOWN;
+   if (_ParseRequest())
+   {
+      bool bHandled = false;
+      for (auto &Route : _Routes)
+      {
+         if (Route.Uri == _Uri && (Route.Method == HTTP_ANY || Route.Method == _Method))
+         {
+            Route.Handler();
+            bHandled = true;
+            break;
+         }
+      }
+      if (!bHandled && _NotFound)
+      {
+         _NotFound();
+      }
+   }
+   else
+   {
+      send(400, "text/plain", "Bad request");
+   }
+   _Client.stop();
+}
+
+static std::string UrlDecode(const std::string &Text)
+{
+   std::string Decoded;
+   for (size_t i = 0; i < Text.size(); i++)
+   {
+      if (Text[i] == '+')
+      {
+         Decoded += ' ';
+      }
+      else if (Text[i] == '%' && i + 2 < Text.size())
+      {
+         Decoded += (char)strtol(Text.substr(i + 1, 2).c_str(), NULL, 16);
+         i += 2;
+      }
+      else
+      {
+         Decoded += Text[i];
+      }
+   }
+   return Decoded;
+}
+
+bool ESP8266WebServer::_ParseRequest()
+{
+   size_t MethodEnd = _Request.find(' ');
+   size_t UrlEnd = _Request.find(' ', MethodEnd + 1);
+   if (MethodEnd == std::string::npos || UrlEnd == std::string::npos)
+   {
+      return false;
+   }
+   std::string strMethod = _Request.substr(0, MethodEnd);
+   std::string strUrl = _Request.substr(MethodEnd + 1, UrlEnd - MethodEnd - 1);
+   _Method = strMethod == "GET" ? HTTP_GET : strMethod == "POST" ? HTTP_POST : strMethod == "HEAD" ? HTTP_HEAD : HTTP_ANY;
+
+   _Args.clear();
+   size_t QueryStart = strUrl.find('?');
+   _Uri = String(strUrl.substr(0, QueryStart));
+   if (QueryStart != std::string::npos)
+   {
+      std::string strQuery = strUrl.substr(QueryStart + 1);
+      size_t Start = 0;
+      while (Start <= strQuery.size())
+      {
+         size_t End = strQuery.find('&', Start);
+         std::string strPair = strQuery.substr(Start, End == std::string::npos ? std::string::npos : End - Start);
+         size_t Equals = strPair.find('=');
+         _Args.push_back({UrlDecode(strPair.substr(0, Equals)), Equals == std::string::npos ? "" : UrlDecode(strPair.substr(Equals + 1))});
+         if (End == std::string::npos)
+         {
+            break;
+         }
+         Start = End + 1;
+      }
+   }
+   return true;
+}
+
+String ESP8266WebServer::arg(const String &name) const
+{
+   for (auto &Arg : _Args)
+   {
+      if (Arg.first == name.c_str())
+      {
+         return String(Arg.second);
+      }
+   }
+   return String();
+}
+
+bool ESP8266WebServer::hasArg(const String &name) const
+{
+   for (auto &Arg : _Args)
+   {
+      if (Arg.first == name.c_str())
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value)
+{
+   _Headers += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+void ESP8266WebServer::send(int code, const char *content_type, const String &content)
+{
+   std::string strResponse = "HTTP/1.1 " + std::to_string(code) + (code == 200 ? " OK" : code == 404 ? " Not Found" : " Error") + "\r\n";
+   if (content_type != NULL)
+   {
+      strResponse += std::string("Content-Type: ") + content_type + "\r\n";
+   }
+   if (_ContentLength != CONTENT_LENGTH_UNKNOWN || content.length() > 0)
+   {
+      size_t Length = _ContentLength != CONTENT_LENGTH_UNKNOWN ? _ContentLength : content.length();
+      strResponse += "Content-Length: " + std::to_string(Length) + "\r\n";
+   }
+   strResponse += _Headers + "Connection: close\r\n\r\n" + content.c_str();
+   _Client.write((const uint8_t *)strResponse.data(), strResponse.size());
+}
+
+void ESP8266WebServer::sendContent(const char *content, size_t size)
+{
+   _Client.write((const uint8_t *)content, size);
+}
+
+/**************************** FS ****************************/
+size_t File::readBytes(char *buffer, size_t length)
+{
+   size_t n = std::min(length, (size_t)available());
+   memcpy(buffer, _Contents->data() + _Position, n);
+   _Position += n;
+   return n;
+}
+
+int File::read()
+{
+   return available() > 0 ? (uint8_t)(*_Contents)[_Position++] : -1;
+}
+
+int File::peek()
+{
+   return available() > 0 ? (uint8_t)(*_Contents)[_Position] : -1;
+}
+
+size_t File::write(uint8_t c)
+{
+   if (!_Contents || !_bWritable)
+   {
+      return 0;
+   }
+   _Contents->push_back(c);
+   return 1;
+}
+
+File FS::open(const char *path, const char *mode)
+{
+   if (mode[0] == 'w')
+   {
+      _Files[path].clear();
+      return File(&_Files[path], true);
+   }
+   if (mode[0] == 'a')
+   {
+      return File(&_Files[path], true);
+   }
+   auto Entry = _Files.find(path);
+   return Entry == _Files.end() ? File() : File(&Entry->second, false);
+}
+
+/**************************** EEPROM ****************************/
+EEPROMClass EEPROM;
+
+void EEPROMClass::begin(size_t size)
+{
+   size = std::min(size, EepromSector.size());
+   _Data.assign(EepromSector.begin(), EepromSector.begin() + size);
+   _bDirty = false;
+}
+
+void EEPROMClass::write(int address, uint8_t val)
+{
+   if ((size_t)address < _Data.size())
+   {
+      _Data[address] = val;
+      _bDirty = true;
+   }
+}
+
+bool EEPROMClass::commit()
+{
+   if (_Data.empty())
+   {
+      return false;
+   }
+   if (_bDirty)
+   {
+      //The real one erases and rewrites the whole sector
+      std::copy(_Data.begin(), _Data.end(), EepromSector.begin());
+      ulEepromCommits++;
+      _bDirty = false;
+   }
+   return true;
+}
+
+bool EEPROMClass::end()
+{
+   bool bCommitted = commit();
+   _Data.clear();
+   return bCommitted;
+}
+
+/**************************** Harness ****************************/
+namespace HostArduino
+{
+void FakeClient::Send(const char *Data)
+{
+   Send((const uint8_t *)Data, strlen(Data));
+}
+
+void FakeClient::Send(const uint8_t *Data, size_t Length)
+{
+   _Conn->RxData.insert(_Conn->RxData.end(), Data, Data + Length);
+}
+
+size_t FakeClient::Receive(uint8_t *Buffer, size_t Size)
+{
+   size_t n = std::min(Size, _Conn->TxData.size());
+   std::copy(_Conn->TxData.begin(), _Conn->TxData.begin() + n, Buffer);
+   _Conn->TxData.erase(_Conn->TxData.begin(), _Conn->TxData.begin() + n);
+   return n;
+}
+
+void FakeClient::Close()
+{
+   _Conn->bRemoteOpen = false;
+}
+
+bool IsListening(uint16_t Port)
+{
+   return ListeningPorts.count(Port) > 0;
+}
+
+FakeClient Connect(uint16_t Port)
+{
+   auto Conn = std::make_shared<Connection>();
+   //Room for a full send window up front, so the display's writes aren't counted as heap allocations of loop()
+   Conn->TxData.reserve(Conn->TxSpace);
+   PendingConnections[Port].push_back(Conn);
+   return FakeClient(Conn);
+}
+
+void SendPacket(uint16_t Port, const uint8_t *Data, size_t Length)
+{
+   auto Pending = PendingPackets.find(Port);
+   if (Pending != PendingPackets.end())
+   {
+      Pending->second.emplace_back(Data, Data + Length);
+   }
+}
+
+void SendPacket(uint16_t Port, const char *Data)
+{
+   SendPacket(Port, (const uint8_t *)Data, strlen(Data));
+}
+
+void AttachShiftRegister(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin, size_t Length)
+{
+   SegmentChain = ShiftRegisterChain();
+   SegmentChain.DataPin = DataPin;
+   SegmentChain.ClockPin = ClockPin;
+   SegmentChain.LatchPin = LatchPin;
+   SegmentChain.Shifted.assign(Length, 0);
+   SegmentChain.Latched.assign(Length, 0);
+}
+
+const ShiftRegisterChain &GetShiftRegister()
+{
+   return SegmentChain;
+}
+
+void RecordShiftRegisterStream(bool bRecord)
+{
+   SegmentChain.bRecordStream = bRecord;
+   SegmentChain.Stream.clear();
+}
+
+void RecordLatches(bool bRecord)
+{
+   SegmentChain.bRecordLatches = bRecord;
+   SegmentChain.LatchHistory.clear();
+}
+
+void RecordReads(bool bRecord)
+{
+   bRecordReads = bRecord;
+   ReadLog.clear();
+}
+
+const std::vector<ReadRecord> &GetReadLog()
+{
+   return ReadLog;
+}
+
+void AdvanceClock(unsigned long Milliseconds)
+{
+   delay(Milliseconds);
+}
+
+unsigned long EepromCommitCount()
+{
+   return ulEepromCommits;
+}
+
+void SetWiFiConnectTime(unsigned long ulMillis)
+{
+   ulWiFiConnectTime = ulMillis;
+}
+
+void SetPinInput(uint8_t Pin, uint8_t Value)
+{
+   PinInputs[Pin & 31] = Value;
+}
+
+void SerialInput(const char *Data)
+{
+   SerialRxData.insert(SerialRxData.end(), Data, Data + strlen(Data));
+}
+
+void SetSerialEcho(bool bEcho)
+{
+   bSerialEcho = bEcho;
+}
+
+unsigned long SerialBytesWritten()
+{
+   return ulSerialBytesWritten;
+}
+} // namespace HostArduino
@@ -0,0 +1,120 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Harness controls for the fake Arduino layer, only available in the [env:native] host build
+
+#ifndef _HostArduino_h
+#define _HostArduino_h
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "WiFiUdp.h"
+#include <deque>
+#include <vector>
+
+namespace HostArduino
+{
+//One TCP connection between a fake remote client and a WiFiServer
+struct Connection
+{
+   std::deque<uint8_t> RxData; //Remote -> display
+   std::vector<uint8_t> TxData; //Display -> remote
+   bool bRemoteOpen = true;
+   bool bLocalOpen = true;
+   bool bNoDelay = false;
+   size_t TxSpace = 2920; //What availableForWrite() reports, like a free TCP send window
+   unsigned long ulReadCalls = 0;
+};
+
+//Remote end of a Connection, used by the harness to act as a network client
+class FakeClient
+{
+public:
+   FakeClient() {}
+   explicit FakeClient(std::shared_ptr<Connection> Conn) : _Conn(Conn) {}
+   void Send(const char *Data);
+   void Send(const uint8_t *Data, size_t Length);
+   size_t Receive(uint8_t *Buffer, size_t Size);
+   size_t ReceivedCount() const { return _Conn ? _Conn->TxData.size() : 0; }
+   void Close();
+   bool IsOpen() const { return _Conn && _Conn->bLocalOpen; }
+   const Connection &GetConnection() const { return *_Conn; }
+   //Room the display sees in its send buffer, 0 acts like a remote that stopped reading
+   void SetTxSpace(size_t Bytes) { _Conn->TxSpace = Bytes; }
+
+private:
+   std::shared_ptr<Connection> _Conn;
+};
+
+//Bit level model of a TPIC6B595 shift register chain, driven through digitalWrite(), shiftOut(), GPOS/GPOC or SPI
+struct ShiftRegisterChain
+{
+   uint8_t DataPin = 0xFF;
+   uint8_t ClockPin = 0xFF;
+   uint8_t LatchPin = 0xFF;
+   std::vector<uint8_t> Shifted; //Index 0 is the register the data pin feeds (leftmost digit)
+   std::vector<uint8_t> Latched;
+   unsigned long ulBitsShifted = 0;
+   unsigned long ulBytesShifted = 0;
+   unsigned long ulLatchCount = 0;
+   unsigned long ulLastLatchMicros = 0;
+   uint8_t CurrentByte = 0;
+   bool bRecordStream = false;
+   std::vector<uint8_t> Stream; //Every byte shifted in, in order, while recording
+   bool bRecordLatches = false;
+   std::vector<std::vector<uint8_t>> LatchHistory; //Every latched frame, in order, while recording
+};
+
+//One byte the firmware read from a connection, see RecordReads()
+struct ReadRecord
+{
+   const Connection *Conn;
+   uint8_t Data;
+};
+
+//Opens a new connection to the WiFiServer listening on Port
+FakeClient Connect(uint16_t Port);
+//True once a WiFiServer on Port called begin()
+bool IsListening(uint16_t Port);
+//Delivers a UDP packet to the WiFiUDP listening on Port, dropped if there is none
+void SendPacket(uint16_t Port, const uint8_t *Data, size_t Length);
+void SendPacket(uint16_t Port, const char *Data);
+
+void AttachShiftRegister(uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin, size_t Length);
+const ShiftRegisterChain &GetShiftRegister();
+void RecordShiftRegisterStream(bool bRecord);
+void RecordLatches(bool bRecord);
+//Logs every byte read from any connection in the order the firmware read them, which is the order messages arrive in
+void RecordReads(bool bRecord);
+const std::vector<ReadRecord> &GetReadLog();
+
+//Moves millis()/micros() forward without waiting, delay() does the same
+void AdvanceClock(unsigned long Milliseconds);
+
+void SetPinInput(uint8_t Pin, uint8_t Value);
+//WiFi.status() reports WL_DISCONNECTED until millis() reaches ulMillis, like a slow association and DHCP at boot
+void SetWiFiConnectTime(unsigned long ulMillis);
+//Sector erases done by EEPROM.commit(), for flash wear
+unsigned long EepromCommitCount();
+
+void SerialInput(const char *Data);
+void SetSerialEcho(bool bEcho);
+unsigned long SerialBytesWritten();
+} // namespace HostArduino
+
+#endif
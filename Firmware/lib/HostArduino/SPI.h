@@ -0,0 +1,48 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake hardware SPI for the host build, bytes are clocked out bit by bit on MOSI/SCK
+
+#ifndef _HostArduino_SPI_h
+#define _HostArduino_SPI_h
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+
+class SPISettings
+{
+public:
+   SPISettings() {}
+   SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {}
+};
+
+class SPIClass
+{
+public:
+   void begin() {}
+   void end() {}
+   void beginTransaction(SPISettings settings) {}
+   void endTransaction() {}
+   uint8_t transfer(uint8_t data);
+   void writeBytes(const uint8_t *data, uint32_t size);
+};
+
+extern SPIClass SPI;
+
+#endif
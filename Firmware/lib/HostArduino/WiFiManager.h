@@ -0,0 +1,49 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake WiFiManager for the host build, the host is always connected
+
+#ifndef _HostArduino_WiFiManager_h
+#define _HostArduino_WiFiManager_h
+
+#include "ESP8266WiFi.h"
+
+class WiFiManagerParameter
+{
+public:
+   WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length) : _Value(defaultValue ? defaultValue : "") {}
+   const char *getValue() { return _Value.c_str(); }
+
+private:
+   std::string _Value;
+};
+
+class WiFiManager
+{
+public:
+   void setSaveConfigCallback(void (*func)(void)) { _SaveConfigCallback = func; }
+   void setSTAStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn) {}
+   boolean autoConnect(const char *apName, const char *apPassword = NULL) { return true; }
+   void resetSettings() {}
+   void addParameter(WiFiManagerParameter *p) {}
+
+private:
+   void (*_SaveConfigCallback)(void) = NULL;
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake WiFiUDP for the host build, packets are injected through HostArduino::SendPacket()
+
+#ifndef _HostArduino_WiFiUdp_h
+#define _HostArduino_WiFiUdp_h
+
+#include "ESP8266WiFi.h"
+#include <vector>
+
+class WiFiUDP
+{
+public:
+   uint8_t begin(uint16_t port);
+   uint8_t beginMulticast(IPAddress interfaceAddr, IPAddress multicast, uint16_t port) { return begin(port); }
+   void stop() { _Port = 0; }
+   int parsePacket();
+   int available() { return (int)(_Packet.size() - _Position); }
+   int read(unsigned char *buffer, size_t len);
+
+private:
+   uint16_t _Port = 0;
+   std::vector<uint8_t> _Packet;
+   size_t _Position = 0;
+};
+
+#endif
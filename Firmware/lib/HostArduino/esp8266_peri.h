@@ -0,0 +1,39 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Fake GPIO output registers for the host build, writes go through the same pin model as digitalWrite()
+
+#ifndef _HostArduino_esp8266_peri_h
+#define _HostArduino_esp8266_peri_h
+
+#include "Arduino.h"
+
+class HostGpioRegister
+{
+public:
+   explicit HostGpioRegister(uint8_t Value) : _Value(Value) {}
+   HostGpioRegister &operator=(uint32_t Mask);
+
+private:
+   uint8_t _Value;
+};
+
+extern HostGpioRegister GPOS; //Writing a pin mask sets those pins HIGH
+extern HostGpioRegister GPOC; //Writing a pin mask sets those pins LOW
+
+#endif
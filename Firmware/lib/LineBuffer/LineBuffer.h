@@ -0,0 +1,108 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LineBuffer_h
+#define _LineBuffer_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Fixed size ring buffer which frames newline (\n) terminated messages without any heap allocation.
+//Each byte is scanned for the terminator only once, no matter how often HasLine() is called.
+template <size_t Capacity>
+class LineBuffer
+{
+   static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "LineBuffer capacity must be a power of 2");
+
+public:
+   //Appends a byte, returns false if the buffer is full
+   bool Push(char cData)
+   {
+      if (_Count == Capacity)
+      {
+         return false;
+      }
+      _Data[(_Head + _Count) & (Capacity - 1)] = cData;
+      _Count++;
+      return true;
+   }
+
+   //Returns true if the buffer holds a complete, newline terminated message
+   bool HasLine()
+   {
+      while (_iLineLength < 0 && _Scanned < _Count)
+      {
+         if (_Data[(_Head + _Scanned) & (Capacity - 1)] == '\n')
+         {
+            _iLineLength = _Scanned;
+         }
+         _Scanned++;
+      }
+      return _iLineLength >= 0;
+   }
+
+   //Copies the oldest complete message (without newline, null terminated) into Buffer and removes it from the ring.
+   //Messages longer than the caller buffer are truncated and removed all the same, returns false if that happened
+   //so the caller can reject the message instead of acting on part of it.
+   bool PopLine(char *Buffer, size_t BufferSize)
+   {
+      if (BufferSize == 0 || !HasLine())
+      {
+         return false;
+      }
+      size_t LineLength = _iLineLength;
+      size_t Copied = LineLength < BufferSize - 1 ? LineLength : BufferSize - 1;
+      for (size_t i = 0; i < Copied; i++)
+      {
+         Buffer[i] = _Data[(_Head + i) & (Capacity - 1)];
+      }
+      Buffer[Copied] = '\0';
+
+      //Drop message and terminator, everything up to here was scanned already
+      _Head = (_Head + LineLength + 1) & (Capacity - 1);
+      _Count -= LineLength + 1;
+      _Scanned = 0;
+      _iLineLength = -1;
+      return Copied == LineLength;
+   }
+
+   void Clear()
+   {
+      _Head = 0;
+      _Count = 0;
+      _Scanned = 0;
+      _iLineLength = -1;
+   }
+
+   //Returns true if the next byte pushed starts a new message
+   bool AtLineStart() const { return _Count == 0 || _Data[(_Head + _Count - 1) & (Capacity - 1)] == '\n'; }
+
+   size_t Length() const { return _Count; }
+   size_t Free() const { return Capacity - _Count; }
+   bool IsEmpty() const { return _Count == 0; }
+   bool IsFull() const { return _Count == Capacity; }
+
+private:
+   char _Data[Capacity];
+   size_t _Head = 0;
+   size_t _Count = 0;
+   size_t _Scanned = 0;
+   int _iLineLength = -1;
+};
+
+#endif
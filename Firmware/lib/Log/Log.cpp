@@ -0,0 +1,107 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Log.h"
+
+Logger Log;
+
+void Logger::Write(const char *Format, ...)
+{
+   char szLine[LOG_LINE_SIZE];
+   va_list Args;
+   va_start(Args, Format);
+   int iLength = vsnprintf_P(szLine, sizeof(szLine), Format, Args);
+   va_end(Args);
+   if (iLength < 0)
+   {
+      return;
+   }
+   if ((size_t)iLength >= sizeof(szLine))
+   {
+      iLength = sizeof(szLine) - 1;
+   }
+
+   if (_ulDropped > 0)
+   {
+      //Tell the reader messages went missing as soon as there is room again
+      char szDropped[40];
+      int iDroppedLength = snprintf(szDropped, sizeof(szDropped), "[%lu log messages dropped]\r\n", _ulDropped);
+      if (!_Append(szDropped, iDroppedLength))
+      {
+         _ulDropped++;
+         return;
+      }
+      _ulDropped = 0;
+   }
+   if (!_Append(szLine, iLength))
+   {
+      _ulDropped++;
+   }
+}
+
+void Logger::WriteRaw(const char *Data, size_t Length)
+{
+   if (!_Append(Data, Length))
+   {
+      _ulDropped++;
+   }
+}
+
+void Logger::Loop()
+{
+   while (_Count > 0)
+   {
+      int iWritable = Serial.availableForWrite();
+      if (iWritable <= 0)
+      {
+         return;
+      }
+      //Only send the contiguous part, the wrapped part goes in the next pass
+      size_t Length = LOG_BUFFER_SIZE - _Head;
+      Length = Length < _Count ? Length : _Count;
+      Length = Length < (size_t)iWritable ? Length : (size_t)iWritable;
+      Serial.write((const uint8_t *)&_Buffer[_Head], Length);
+      _Head = (_Head + Length) % LOG_BUFFER_SIZE;
+      _Count -= Length;
+   }
+}
+
+void Logger::Flush()
+{
+   //Blocking, only for boot and right before a reset
+   while (_Count > 0)
+   {
+      Loop();
+      yield();
+   }
+   Serial.flush();
+}
+
+bool Logger::_Append(const char *Data, size_t Length)
+{
+   if (LOG_BUFFER_SIZE - _Count < Length)
+   {
+      return false;
+   }
+   for (size_t i = 0; i < Length; i++)
+   {
+      _Buffer[(_Head + _Count + i) % LOG_BUFFER_SIZE] = Data[i];
+   }
+   _Count += Length;
+   return true;
+}
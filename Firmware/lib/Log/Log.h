@@ -0,0 +1,96 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Log_h
+#define _Log_h
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+//Selected with -DLOG_LEVEL=... in platformio.ini, messages below this level are compiled out entirely
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_BUFFER_SIZE 1024 //RAM buffer for messages waiting to be sent to the UART
+#define LOG_LINE_SIZE 128    //Longest single log message, longer ones are truncated
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) Log.Write(PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) \
+   do                          \
+   {                           \
+   } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) Log.Write(PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) \
+   do                         \
+   {                          \
+   } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) Log.Write(PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) \
+   do                         \
+   {                          \
+   } while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) Log.Write(PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) \
+   do                          \
+   {                           \
+   } while (0)
+#endif
+
+//Buffers formatted log messages in RAM so logging never waits for the UART.
+//Loop() sends only as much as the UART TX FIFO can take without blocking.
+class Logger
+{
+public:
+   void Write(const char *Format, ...);
+   //Queues Data as it is, for answers to serial commands which can be longer than a log line
+   void WriteRaw(const char *Data, size_t Length);
+   void Loop();
+   void Flush();
+
+private:
+   char _Buffer[LOG_BUFFER_SIZE];
+   size_t _Head = 0;
+   size_t _Count = 0;
+   unsigned long _ulDropped = 0;
+
+   bool _Append(const char *Data, size_t Length);
+};
+
+extern Logger Log;
+
+#endif
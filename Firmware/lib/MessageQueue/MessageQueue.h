@@ -0,0 +1,104 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MessageQueue_h
+#define _MessageQueue_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MESSAGE_MAX_LENGTH 32 //Including null terminator
+#define MESSAGE_QUEUE_SIZE 16 //Complete messages waiting to be handled, from all input sources
+
+enum MessageType : uint8_t
+{
+   MESSAGE_TEXT,   //szData is a null terminated line
+   MESSAGE_BINARY, //szData holds the iLength byte body of a binary frame, see BinaryFrame.h
+};
+
+//A complete message, tagged with where and when it was received
+struct QueuedMessage
+{
+   uint8_t iSource;               //Client slot the message came from, or a *_MESSAGE_SOURCE for other inputs
+   uint16_t iSequence;            //Number of the message on its connection
+   MessageType Type;
+   uint8_t iLength;               //Binary frames only, 0 for a frame that failed its checks
+   unsigned long ulArrivalMicros; //micros() when the message was framed
+   char szData[MESSAGE_MAX_LENGTH];
+};
+
+//Bounded FIFO of complete messages, messages are stored in place so queueing never allocates
+template <size_t Capacity>
+class MessageQueue
+{
+public:
+   //Returns the slot at the back of the queue for the caller to fill in, or NULL if the queue is full.
+   //The slot only becomes part of the queue after Commit().
+   QueuedMessage *Reserve()
+   {
+      if (IsFull())
+      {
+         return NULL;
+      }
+      return &_Messages[(_Head + _Count) % Capacity];
+   }
+
+   void Commit()
+   {
+      _Count++;
+   }
+
+   //Returns the oldest message, or NULL if the queue is empty
+   const QueuedMessage *Front() const
+   {
+      return IsEmpty() ? NULL : &_Messages[_Head];
+   }
+
+   //Returns the message Index places behind the oldest one, or NULL if there are not that many messages
+   const QueuedMessage *Peek(size_t Index) const
+   {
+      return Index >= _Count ? NULL : &_Messages[(_Head + Index) % Capacity];
+   }
+
+   void PopFront()
+   {
+      if (IsEmpty())
+      {
+         return;
+      }
+      _Head = (_Head + 1) % Capacity;
+      _Count--;
+   }
+
+   size_t Count() const { return _Count; }
+   bool IsEmpty() const { return _Count == 0; }
+   bool IsFull() const { return _Count == Capacity; }
+
+private:
+   QueuedMessage _Messages[Capacity];
+   size_t _Head = 0;
+   size_t _Count = 0;
+};
+
+//The queue every input source feeds, so all commands are handled in order of arrival by the same parser.
+//An input source frames the bytes it receives in its own buffer and only queues complete messages, tagged with its
+//iSource: NetworkServer for the TCP client slots, SerialSource for the UART. Their Loop() never blocks, a message that
+//doesn't fit in a full queue waits in the source's buffer.
+typedef MessageQueue<MESSAGE_QUEUE_SIZE> CommandQueue;
+
+#endif
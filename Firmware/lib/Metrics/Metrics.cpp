@@ -0,0 +1,66 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Metrics.h"
+#include <string.h>
+
+uint32_t DurationHistogram::GetCount() const
+{
+   uint32_t ulCount = 0;
+   for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+   {
+      ulCount += _Buckets[i];
+   }
+   return ulCount;
+}
+
+uint32_t DurationHistogram::GetPercentile(uint8_t iPercent) const
+{
+   uint32_t ulCount = GetCount();
+   if (ulCount == 0)
+   {
+      return 0;
+   }
+   //Rank of the sample, rounded up so p100 is the last sample
+   uint32_t ulRank = ((uint64_t)ulCount * iPercent + 99) / 100;
+   uint32_t ulSeen = 0;
+   for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+   {
+      ulSeen += _Buckets[i];
+      if (ulSeen >= ulRank && ulSeen > 0)
+      {
+         uint32_t ulUpper = i == 0 ? 0 : (1UL << i) - 1;
+         return i == METRICS_HISTOGRAM_BUCKETS - 1 || ulUpper > _ulMax ? _ulMax : ulUpper;
+      }
+   }
+   return _ulMax;
+}
+
+void DurationHistogram::_Halve()
+{
+   for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+   {
+      _Buckets[i] /= 2;
+   }
+}
+
+void DurationHistogram::Reset()
+{
+   memset(_Buckets, 0, sizeof(_Buckets));
+   _ulMax = 0;
+}
@@ -0,0 +1,85 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Runtime metrics with constant memory use, read out with the STATS command.
+//Building with -DMETRICS_ENABLED=0 compiles every METRICS_... statement out, the counters included.
+
+#ifndef _Metrics_h
+#define _Metrics_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef METRICS_ENABLED
+#define METRICS_ENABLED 1
+#endif
+
+#define METRICS_HISTOGRAM_BUCKETS 16 //Bucket 0 holds 0 us, bucket n 2^(n-1) up to 2^n - 1 us, the last one everything above
+
+#if METRICS_ENABLED
+#define METRICS_ADD(Counter, Value) ((Counter) += (Value))
+#define METRICS_COUNT(Counter) ((Counter)++)
+#define METRICS_RECORD(Histogram, Micros) ((Histogram).Record(Micros))
+#else
+#define METRICS_ADD(Counter, Value) \
+   do                               \
+   {                                \
+   } while (0)
+#define METRICS_COUNT(Counter) \
+   do                          \
+   {                           \
+   } while (0)
+#define METRICS_RECORD(Histogram, Micros) \
+   do                                     \
+   {                                      \
+   } while (0)
+#endif
+
+//Histogram of durations in power of 2 buckets. Recording a sample is a leading zero count and two increments,
+//percentiles are only worked out when read and are reported as the upper end of their bucket.
+class DurationHistogram
+{
+public:
+   void Record(uint32_t ulMicros)
+   {
+      uint8_t iBucket = ulMicros == 0 ? 0 : 32 - __builtin_clz(ulMicros);
+      if (++_Buckets[iBucket < METRICS_HISTOGRAM_BUCKETS ? iBucket : METRICS_HISTOGRAM_BUCKETS - 1] == UINT32_MAX)
+      {
+         _Halve();
+      }
+      if (ulMicros > _ulMax)
+      {
+         _ulMax = ulMicros;
+      }
+   }
+
+   //Samples in the histogram. A long run halves every bucket when one would overflow, the shape stays the same.
+   uint32_t GetCount() const;
+   uint32_t GetMax() const { return _ulMax; }
+   //Upper end of the bucket below which iPercent of the samples are, capped at the largest sample
+   uint32_t GetPercentile(uint8_t iPercent) const;
+   void Reset();
+
+private:
+   uint32_t _Buckets[METRICS_HISTOGRAM_BUCKETS] = {};
+   uint32_t _ulMax = 0;
+
+   void _Halve();
+};
+
+#endif
@@ -20,57 +20,600 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define _NetworkServer_h
 
 #if defined(ARDUINO) && ARDUINO >= 100
-#include "arduino.h"
+#include "Arduino.h"
 #else
 #include "WProgram.h"
 #endif
 
-#include <ESP8266WiFi.h>
+#include <LineBuffer.h>
+#include <MessageQueue.h>
+#include <BinaryFrame.h>
+#include <Metrics.h>
+#include <Log.h>
 #define CLIENT_TIMEOUT 5000
+#define NETWORK_CLIENT_SLOTS 4 //Default slot count
+#define CLIENT_BUFFER_SIZE 64 //Receive buffer per client, must be a power of 2
 #define ACK_MSG 0x06
 #define NAK_MSG 0x15
 #define ENQ_MSG 0x05
+#define SEQUENCE_MODE_CMD "SEQ" //Switches a connection to sequenced replies, see Reply()
 
+//Fairness settings, can be overridden with build flags
+#ifndef CLIENT_RATE_LIMIT
+#define CLIENT_RATE_LIMIT 2000 //Bytes per second each client may send, 0 disables the limit
+#endif
+#ifndef CLIENT_RATE_BURST
+#define CLIENT_RATE_BURST 128 //Bytes a client may send at once after being quiet
+#endif
+#ifndef NETWORK_LOOP_BYTE_BUDGET
+#define NETWORK_LOOP_BYTE_BUDGET 128 //Bytes read from all clients together in one Loop()
+#endif
+#ifndef CLIENT_IDLE_TIME
+#define CLIENT_IDLE_TIME 10000 //Only clients quiet for this long (ms) are kicked out to make room for a new one
+#endif
+
+//State of one client slot, for status pages
+struct NetworkSlotInfo
+{
+   bool bConnected;
+   bool bSequenced;
+   unsigned long ulIdleMillis; //Since the last data received, 0 when not connected
+};
+
+//Server wide counters, only kept with METRICS_ENABLED
+struct NetworkServerStats
+{
+   unsigned long ulConnects;
+   unsigned long ulRefused;   //New connections turned away because every client was active
+   unsigned long ulEvictions; //Idle clients kicked out to make room for a new one
+   unsigned long ulTimeouts;  //Partial messages dropped after CLIENT_TIMEOUT
+   unsigned long ulOverflows; //Receive buffers that filled up without a complete message, and lines too long to queue
+};
+
+//Traffic per client slot, counted over every connection the slot has served
+struct NetworkSlotStats
+{
+   unsigned long ulMessages;
+   unsigned long ulBytes;
+};
+
+//Line based message server, generic over the number of client slots and the transport.
+//A transport is a struct with Server and Client types shaped like WiFiServer and WiFiClient,
+//see WiFiTransport.h for the ESP8266 one and lib/PosixTransport for plain sockets on a PC.
+template <class Transport, uint8_t Slots = NETWORK_CLIENT_SLOTS>
 class NetworkServer
 {
+   static_assert(Slots > 0 && Slots < 255, "Slot indexes are uint8_t, with Slots itself meaning no slot");
+   static_assert(BINARY_FRAME_MAX_BODY <= MESSAGE_MAX_LENGTH, "A binary frame body must fit in a queued message");
+
 protected:
 
 public:
-   void init(WiFiServer* Server);
+   void init(typename Transport::Server *Server);
    void Loop();
-   String GetOldestData();
-   bool Available();
+   bool GetMessage(QueuedMessage &Message);
+   //Returns the message GetMessage() would return next without removing it, or NULL if there is none
+   const QueuedMessage *PeekMessage();
+   //The queue GetMessage() reads from, other input sources can queue their messages in it as well (see MessageQueue.h)
+   CommandQueue &GetQueue() { return _Messages; }
+   //Reports that a message from GetMessage() has been handled, call it for every message in order.
+   //Plain connections are ACKed as soon as a message is received, so this only matters for connections which
+   //sent SEQUENCE_MODE_CMD. Those get an ACK_MSG or NAK_MSG frame with the message's sequence number:
+   //<ACK_MSG|NAK_MSG><sequence number in decimal>\n, and an ENQ_MSG is answered with
+   //ENQ_MSG<sequence number of the last reply>\n, which can't be mistaken for a message reply.
+   void Reply(const QueuedMessage &Message, bool bAccepted);
+   //Writes Data to the client a message came from, for answers that carry data (e.g. clock sync)
+   void Send(const QueuedMessage &Message, const uint8_t *Data, size_t Length);
+   //Logs the state of every slot, only compiled in with debug logging. Call it from a timer, Loop() doesn't.
+   void LogClientStates();
+   NetworkSlotInfo GetSlotInfo(uint8_t iSlot) const;
+#if METRICS_ENABLED
+   const NetworkServerStats &GetStats() const { return _Stats; }
+   const NetworkSlotStats &GetSlotStats(uint8_t iSlot) const { return _SlotStats[iSlot]; }
+#endif
 
 private:
-   //struct to manage wifi connected clients
+   //struct to manage wifi connected clients.
+   //Slots are only ever referred to by reference or index, copying one would duplicate its client and buffer.
    struct _NetworkClient
    {
+      _NetworkClient() = default;
+      _NetworkClient(const _NetworkClient &) = delete;
+      _NetworkClient &operator=(const _NetworkClient &) = delete;
+
       bool bClientConnected = false;
-      WiFiClient ClientObj;
+      typename Transport::Client ClientObj;
       uint iLastActivityTime = 0;
-      String strReceivedData;
-      bool bDataComplete = false;
+      LineBuffer<CLIENT_BUFFER_SIZE> ReceiveBuffer;
+      BinaryFrameReader FrameReader;
+      //Dropping the rest of a frame with a bad header, up to the next frame start or newline
+      bool bDiscarding = false;
+      //Token bucket for CLIENT_RATE_LIMIT, one token per byte
+      uint16_t iTokens = CLIENT_RATE_BURST;
+      unsigned long ulLastRefillTime = 0;
+      //Sequenced reply mode, messages are numbered from 1 after SEQUENCE_MODE_CMD
+      bool bSequenced = false;
+      uint16_t iNextSequence = 0;
+      uint16_t iLastReplied = 0;
    };
-   //Array to manage 5 different clients
-   _NetworkClient _NetworkClients[4];
+   //Array to manage the different clients
+   _NetworkClient _NetworkClients[Slots];
 
-   WiFiServer* _Server;
+   //Complete messages from all clients, in order of arrival
+   CommandQueue _Messages;
 
-   uint _iLastNetworkCheck = 0;
-   uint _iNetworkCheckTimer = 10;
+   typename Transport::Server *_Server;
 
-   unsigned long _ulLastStatusLog = 0;
+   uint8_t _iFirstSlot = 0; //Slot served first in the next Loop(), rotates for round-robin
+   //Slot holding complete messages that didn't fit in the full queue, Slots if none. Nothing is read until they are
+   //queued, or messages read later from another client would overtake them.
+   uint8_t _iBacklogSlot = Slots;
+#if METRICS_ENABLED
+   NetworkServerStats _Stats = {};
+   NetworkSlotStats _SlotStats[Slots] = {};
+#endif
 
    void _NetworkAccept();
    void _NetworkListen();
-   _NetworkClient &_GetFreeNetworkClient();
+   //Returns Slots if every slot is in use by an active client
+   uint8_t _GetFreeNetworkClient();
+   size_t _GetReadAllowance(_NetworkClient &Client);
    void _ResetNetworkClient(_NetworkClient & Client);
    void _DisconnectNetworkClient(_NetworkClient & Client);
-   _NetworkClient &_GetOldestClientWithDataComplete();
+   //Queues the client's complete lines, returns the number of plain ACKs still to send
+   size_t _QueueMessages(_NetworkClient &Client, uint8_t iSlot, size_t AckCount);
+   //Queues the frame the client's FrameReader just finished, returns the number of plain ACKs still to send
+   size_t _QueueFrame(_NetworkClient &Client, uint8_t iSlot, bool bValid, size_t AckCount);
+   void _SendAcks(_NetworkClient &Client, size_t AckCount);
+   void _SendSequenceFrame(_NetworkClient &Client, uint8_t Type, uint16_t iSequence);
 
-   void _LogClientStates();
 
 };
 
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::init(typename Transport::Server *Server)
+{
+   _Server = Server;
+   return;
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::Loop()
+{
+   _NetworkAccept();
+   _NetworkListen();
+}
+
+template <class Transport, uint8_t Slots>
+bool NetworkServer<Transport, Slots>::GetMessage(QueuedMessage &Message)
+{
+   auto OldestMessage = _Messages.Front();
+   if (OldestMessage == NULL)
+   {
+      return false;
+   }
+
+   Message = *OldestMessage;
+   _Messages.PopFront();
+   LOG_DEBUG("Found data in client %i: '%s'!\r\n", Message.iSource, Message.szData);
+   return true;
+}
+
+template <class Transport, uint8_t Slots>
+const QueuedMessage *NetworkServer<Transport, Slots>::PeekMessage()
+{
+   return _Messages.Front();
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::Reply(const QueuedMessage &Message, bool bAccepted)
+{
+   //Messages are always handled in the loop they were queued in, so the slot still holds the client that sent it.
+   //Messages from other input sources in a shared queue are not answered here.
+   if (Message.iSource >= Slots)
+   {
+      return;
+   }
+   auto &Client = _NetworkClients[Message.iSource];
+   if (!Client.bClientConnected || !Client.bSequenced)
+   {
+      return;
+   }
+   Client.iLastReplied = Message.iSequence;
+   _SendSequenceFrame(Client, bAccepted ? ACK_MSG : NAK_MSG, Message.iSequence);
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::Send(const QueuedMessage &Message, const uint8_t *Data, size_t Length)
+{
+   if (Message.iSource >= Slots || !_NetworkClients[Message.iSource].bClientConnected)
+   {
+      return;
+   }
+   _NetworkClients[Message.iSource].ClientObj.write(Data, Length);
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_NetworkAccept()
+{
+   //Listen on server
+   auto ClientObj = _Server->available();
+   if (ClientObj.connected())
+   {
+      LOG_DEBUG("Connection available\r\n");
+      uint8_t iSlot = _GetFreeNetworkClient();
+      if (iSlot == Slots)
+      {
+         //Don't kick out a client that is still sending
+         LOG_WARN("All clients active, refusing new connection\r\n");
+         METRICS_COUNT(_Stats.ulRefused);
+         ClientObj.stop();
+         return;
+      }
+      auto &Client = _NetworkClients[iSlot];
+      Client.ClientObj = ClientObj;
+      //Replies are single bytes, don't let Nagle's algorithm hold them back
+      Client.ClientObj.setNoDelay(true);
+      //client.flush();
+      LOG_INFO("Client connected!\r\n");
+      METRICS_COUNT(_Stats.ulConnects);
+      Client.iLastActivityTime = millis();
+      Client.bClientConnected = true;
+      Client.iTokens = CLIENT_RATE_BURST;
+      Client.ulLastRefillTime = millis();
+      Client.bSequenced = false;
+   }
+}
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_NetworkListen()
+{
+   //Messages left over when the queue was full go first
+   if (_iBacklogSlot < Slots)
+   {
+      auto &Client = _NetworkClients[_iBacklogSlot];
+      _SendAcks(Client, _QueueMessages(Client, _iBacklogSlot, 0));
+      if (!Client.ReceiveBuffer.HasLine())
+      {
+         _iBacklogSlot = Slots;
+      }
+   }
+
+   //Serve clients round-robin, starting one slot further every loop, until the byte budget is used up
+   size_t Budget = NETWORK_LOOP_BYTE_BUDGET;
+   for (uint8_t n = 0; n < Slots; n++)
+   {
+      uint8_t i = (_iFirstSlot + n) % Slots;
+      auto &Client = _NetworkClients[i];
+      //Handle client disconnects
+      if (Client.bClientConnected && !Client.ClientObj.connected())
+      {
+         //Client has closed connection, close it from our side as well
+         _ResetNetworkClient(Client);
+         _DisconnectNetworkClient(Client);
+      }
+
+      size_t AckCount = 0;
+      if (Client.bClientConnected && millis() - Client.iLastActivityTime > CLIENT_TIMEOUT &&
+          (!Client.ReceiveBuffer.IsEmpty() || Client.FrameReader.IsActive()))
+      {
+         //Timeout, reset buffer
+         _ResetNetworkClient(Client);
+         LOG_WARN("No data received after timeout (%is), resetting buffer...\r\n", CLIENT_TIMEOUT / 1000);
+         METRICS_COUNT(_Stats.ulTimeouts);
+      }
+      else if (_iBacklogSlot == Slots && Client.ClientObj.available() > 0 && !Client.ReceiveBuffer.IsFull() && Budget > 0 &&
+               _GetReadAllowance(Client) > 0)
+      {
+         //Drain as much as fits in the receive buffer and the client's allowance with a single read,
+         //anything more stays in the socket until a later loop
+         uint8_t Chunk[CLIENT_BUFFER_SIZE];
+         int iRead = Client.ClientObj.read(Chunk, std::min(_GetReadAllowance(Client), Budget));
+         if (iRead < 0)
+         {
+            iRead = 0;
+         }
+         Budget -= iRead;
+         METRICS_ADD(_SlotStats[i].ulBytes, iRead);
+#if CLIENT_RATE_LIMIT > 0
+         Client.iTokens -= iRead;
+#endif
+         for (int j = 0; j < iRead; j++)
+         {
+            //The body of a frame with a bad header must not be read as text, it could hold ENQ or a newline
+            if (Client.bDiscarding)
+            {
+               Client.bDiscarding = Chunk[j] != '\n' && Chunk[j] != BINARY_FRAME_START;
+               if (Chunk[j] != BINARY_FRAME_START)
+               {
+                  continue;
+               }
+            }
+
+            //A binary frame starts with STX at a message boundary and may hold any byte, ENQ included
+            if (Client.FrameReader.IsActive() || (Chunk[j] == BINARY_FRAME_START && Client.ReceiveBuffer.AtLineStart()))
+            {
+               BinaryFrameResult Result = Client.FrameReader.Push(Chunk[j]);
+               if (Result != BINARY_FRAME_INCOMPLETE)
+               {
+                  //Lines received before the frame go first, so messages keep their order
+                  AckCount = _QueueMessages(Client, i, AckCount);
+                  AckCount = _QueueFrame(Client, i, Result == BINARY_FRAME_COMPLETE, AckCount);
+                  Client.bDiscarding = Result == BINARY_FRAME_BAD_HEADER;
+               }
+               continue;
+            }
+
+            //ENQ is answered right away and not stored
+            if (Chunk[j] == ENQ_MSG)
+            {
+               if (Client.bSequenced)
+               {
+                  _SendSequenceFrame(Client, ENQ_MSG, Client.iLastReplied);
+               }
+               else
+               {
+                  AckCount++;
+               }
+               continue;
+            }
+            Client.ReceiveBuffer.Push(Chunk[j]);
+         }
+         LOG_DEBUG("Received %i bytes from client %i\r\n", iRead, i);
+         Client.iLastActivityTime = millis();
+      }
+
+      //Move complete messages to the queue, on plain connections every queued message is confirmed with an ACK
+      AckCount = _QueueMessages(Client, i, AckCount);
+      _SendAcks(Client, AckCount);
+      if (Client.ReceiveBuffer.HasLine())
+      {
+         _iBacklogSlot = i;
+      }
+
+      if (Client.ReceiveBuffer.IsFull() && !Client.ReceiveBuffer.HasLine())
+      {
+         //Buffer is full without a complete message, this can't be valid data
+         LOG_WARN("Receive buffer overflow, discarding %i bytes\r\n", CLIENT_BUFFER_SIZE);
+         METRICS_COUNT(_Stats.ulOverflows);
+         _ResetNetworkClient(Client);
+      }
+   }
+   _iFirstSlot = (_iFirstSlot + 1) % Slots;
+}
+
+template <class Transport, uint8_t Slots>
+size_t NetworkServer<Transport, Slots>::_GetReadAllowance(_NetworkClient &Client)
+{
+   size_t Allowance = Client.ReceiveBuffer.Free();
+#if CLIENT_RATE_LIMIT > 0
+   //Refill the token bucket, the refill time only moves on by the tokens actually added so no fraction is lost
+   unsigned long ulElapsed = millis() - Client.ulLastRefillTime;
+   if (ulElapsed >= (unsigned long)CLIENT_RATE_BURST * 1000 / CLIENT_RATE_LIMIT)
+   {
+      Client.iTokens = CLIENT_RATE_BURST;
+      Client.ulLastRefillTime = millis();
+   }
+   else
+   {
+      unsigned long ulRefill = ulElapsed * CLIENT_RATE_LIMIT / 1000;
+      if (ulRefill > 0)
+      {
+         Client.iTokens = std::min<unsigned long>(CLIENT_RATE_BURST, Client.iTokens + ulRefill);
+         Client.ulLastRefillTime += ulRefill * 1000 / CLIENT_RATE_LIMIT;
+      }
+   }
+   Allowance = std::min<size_t>(Allowance, Client.iTokens);
+#endif
+   return Allowance;
+}
+
+template <class Transport, uint8_t Slots>
+uint8_t NetworkServer<Transport, Slots>::_GetFreeNetworkClient()
+{
+   uint8_t iIdlestClient = Slots;
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      auto &Client = _NetworkClients[i];
+      LOG_DEBUG("Client %i last active: %i\r\n", i, Client.iLastActivityTime);
+      if (!Client.bClientConnected && Client.ReceiveBuffer.IsEmpty())
+      {
+         //Free client found, assign it
+         LOG_DEBUG("Found free client: %i\r\n", i);
+         return i;
+      }
+      //Keep track of the idlest client in case we have no more free ones, compare ages so millis() rollover is harmless.
+      //Clients which sent something recently or are in the middle of a message are never picked.
+      unsigned long ulIdleTime = millis() - Client.iLastActivityTime;
+      if (ulIdleTime < CLIENT_IDLE_TIME || !Client.ReceiveBuffer.IsEmpty())
+      {
+         continue;
+      }
+      if (iIdlestClient == Slots || ulIdleTime > millis() - _NetworkClients[iIdlestClient].iLastActivityTime)
+      {
+         iIdlestClient = i;
+      }
+   }
+
+   if (iIdlestClient == Slots)
+   {
+      return Slots;
+   }
+
+   //No free client is found.
+   //Reset idlest (kick it out) and return that one
+   auto &IdlestClient = _NetworkClients[iIdlestClient];
+   LOG_WARN("Using idle client (%i) with last activity at %i\r\n", iIdlestClient, IdlestClient.iLastActivityTime);
+   METRICS_COUNT(_Stats.ulEvictions);
+   _ResetNetworkClient(IdlestClient);
+   _DisconnectNetworkClient(IdlestClient);
+   return iIdlestClient;
+}
+
+template <class Transport, uint8_t Slots>
+size_t NetworkServer<Transport, Slots>::_QueueMessages(_NetworkClient &Client, uint8_t iSlot, size_t AckCount)
+{
+   QueuedMessage *Message;
+   //Messages stay in the client buffer while the queue is full
+   while (Client.ReceiveBuffer.HasLine() && (Message = _Messages.Reserve()) != NULL)
+   {
+      Message->iSource = iSlot;
+      Message->ulArrivalMicros = micros();
+      if (!Client.ReceiveBuffer.PopLine(Message->szData, sizeof(Message->szData)))
+      {
+         //Part of a command could still be valid, so a line which doesn't fit the queue is never executed
+         LOG_WARN("Line from client %i longer than %i characters, dropping it\r\n", iSlot, MESSAGE_MAX_LENGTH - 1);
+         METRICS_COUNT(_Stats.ulOverflows);
+         if (Client.bSequenced)
+         {
+            //Queued empty, so its NAK is sent in order with the other replies
+            Message->szData[0] = '\0';
+         }
+         else
+         {
+            //The NAK must come after the ACKs for everything received before the line
+            _SendAcks(Client, AckCount);
+            AckCount = 0;
+            const uint8_t Nak = NAK_MSG;
+            Client.ClientObj.write(&Nak, 1);
+            continue;
+         }
+      }
+
+      //Switching to sequenced replies is handled here, it is not a display command
+      size_t Length = strlen(Message->szData);
+      if (Length > 0 && Message->szData[Length - 1] == '\r')
+      {
+         Length--;
+      }
+      if (Length == strlen(SEQUENCE_MODE_CMD) && strncmp(Message->szData, SEQUENCE_MODE_CMD, Length) == 0)
+      {
+         Client.bSequenced = true;
+         Client.iNextSequence = 1;
+         Client.iLastReplied = 0;
+         _SendSequenceFrame(Client, ACK_MSG, 0);
+         LOG_INFO("Client %i switched to sequenced replies\r\n", iSlot);
+         continue;
+      }
+
+      Message->Type = MESSAGE_TEXT;
+      Message->iSequence = Client.iNextSequence++;
+      _Messages.Commit();
+      METRICS_COUNT(_SlotStats[iSlot].ulMessages);
+      LOG_DEBUG("Received: '%s'\r\n", Message->szData);
+      if (!Client.bSequenced)
+      {
+         AckCount++;
+      }
+   }
+   return AckCount;
+}
+
+template <class Transport, uint8_t Slots>
+size_t NetworkServer<Transport, Slots>::_QueueFrame(_NetworkClient &Client, uint8_t iSlot, bool bValid, size_t AckCount)
+{
+   //Sequenced connections get a broken frame queued empty, so its NAK is sent in order with the other replies
+   QueuedMessage *Message = (bValid || Client.bSequenced) ? _Messages.Reserve() : NULL;
+   if (Message == NULL)
+   {
+      //PSTR() on the ESP8266 needs a string literal
+      if (bValid)
+      {
+         LOG_WARN("Message queue full, dropping binary frame\r\n");
+      }
+      else
+      {
+         LOG_WARN("Invalid binary frame received\r\n");
+      }
+      if (Client.bSequenced)
+      {
+         _SendSequenceFrame(Client, NAK_MSG, Client.iNextSequence++);
+         return AckCount;
+      }
+      //The NAK must come after the ACKs for everything received before the frame
+      _SendAcks(Client, AckCount);
+      const uint8_t Nak = NAK_MSG;
+      Client.ClientObj.write(&Nak, 1);
+      return 0;
+   }
+
+   Message->iSource = iSlot;
+   Message->ulArrivalMicros = micros();
+   Message->Type = MESSAGE_BINARY;
+   Message->iLength = bValid ? Client.FrameReader.BodyLength() : 0;
+   memcpy(Message->szData, Client.FrameReader.Body(), Message->iLength);
+   Message->iSequence = Client.iNextSequence++;
+   _Messages.Commit();
+   METRICS_COUNT(_SlotStats[iSlot].ulMessages);
+   LOG_DEBUG("Received binary frame of %i bytes\r\n", Message->iLength);
+   return Client.bSequenced ? AckCount : AckCount + 1;
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_SendAcks(_NetworkClient &Client, size_t AckCount)
+{
+   if (AckCount == 0)
+   {
+      return;
+   }
+   uint8_t Acks[CLIENT_BUFFER_SIZE + MESSAGE_QUEUE_SIZE];
+   memset(Acks, ACK_MSG, AckCount);
+   Client.ClientObj.write(Acks, AckCount);
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_SendSequenceFrame(_NetworkClient &Client, uint8_t Type, uint16_t iSequence)
+{
+   char Frame[8];
+   Frame[0] = Type;
+   int iLength = 1 + snprintf(Frame + 1, sizeof(Frame) - 1, "%u\n", iSequence);
+   Client.ClientObj.write((const uint8_t *)Frame, iLength);
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_ResetNetworkClient(_NetworkClient &Client)
+{
+   LOG_DEBUG("Client buffer cleared\r\n");
+   Client.ReceiveBuffer.Clear();
+   Client.FrameReader.Reset();
+   Client.bDiscarding = false;
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::_DisconnectNetworkClient(_NetworkClient &Client)
+{
+   if (Client.ClientObj.connected())
+   {
+      Client.ClientObj.stop();
+   }
+   LOG_INFO("Client disconnected\r\n");
+   Client.bClientConnected = false;
+   Client.bSequenced = false;
+   Client.iLastActivityTime = 0;
+   _ResetNetworkClient(Client);
+}
+
+template <class Transport, uint8_t Slots>
+NetworkSlotInfo NetworkServer<Transport, Slots>::GetSlotInfo(uint8_t iSlot) const
+{
+   const auto &Client = _NetworkClients[iSlot];
+   NetworkSlotInfo Info;
+   Info.bConnected = Client.bClientConnected;
+   Info.bSequenced = Client.bClientConnected && Client.bSequenced;
+   Info.ulIdleMillis = Client.bClientConnected ? millis() - Client.iLastActivityTime : 0;
+   return Info;
+}
+
+template <class Transport, uint8_t Slots>
+void NetworkServer<Transport, Slots>::LogClientStates()
+{
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      auto &Client = _NetworkClients[i];
+      LOG_DEBUG("Client %i: C: %i | CO: %i | LaT: %i\r\n", i, Client.bClientConnected, Client.ClientObj.connected(), Client.iLastActivityTime);
+   }
+#endif
+}
+
 #endif
 
@@ -0,0 +1,33 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WiFiTransport_h
+#define _WiFiTransport_h
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+//NetworkServer and UdpListener transport for the ESP8266 WiFi stack
+struct WiFiTransport
+{
+   typedef WiFiServer Server;
+   typedef WiFiClient Client;
+   typedef WiFiUDP Udp;
+};
+
+#endif
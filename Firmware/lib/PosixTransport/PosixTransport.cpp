@@ -0,0 +1,239 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PosixTransport.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <set>
+#include <vector>
+
+//Sockets of every connected client and UDP listener, so wait() can poll them without the server tracking slots
+static std::set<int> OpenSockets;
+
+uint8_t PosixClient::connected()
+{
+   if (_Socket < 0)
+   {
+      return 0;
+   }
+   //Like WiFiClient, unread data keeps the client 'connected'
+   uint8_t Byte;
+   ssize_t Result = recv(_Socket, &Byte, 1, MSG_PEEK | MSG_DONTWAIT);
+   if (Result > 0)
+   {
+      return 1;
+   }
+   return Result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+int PosixClient::available()
+{
+   int iPending = 0;
+   if (_Socket < 0 || ioctl(_Socket, FIONREAD, &iPending) < 0)
+   {
+      return 0;
+   }
+   return iPending;
+}
+
+int PosixClient::read(uint8_t *buffer, size_t size)
+{
+   if (_Socket < 0)
+   {
+      return -1;
+   }
+   ssize_t Result = recv(_Socket, buffer, size, MSG_DONTWAIT);
+   if (Result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+   {
+      return 0;
+   }
+   return Result;
+}
+
+size_t PosixClient::write(const uint8_t *buffer, size_t size)
+{
+   if (_Socket < 0)
+   {
+      return 0;
+   }
+   ssize_t Result = send(_Socket, buffer, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+   return Result < 0 ? 0 : Result;
+}
+
+void PosixClient::stop()
+{
+   if (_Socket < 0)
+   {
+      return;
+   }
+   OpenSockets.erase(_Socket);
+   close(_Socket);
+   _Socket = -1;
+}
+
+void PosixClient::setNoDelay(bool nodelay)
+{
+   int iValue = nodelay;
+   setsockopt(_Socket, IPPROTO_TCP, TCP_NODELAY, &iValue, sizeof(iValue));
+}
+
+PosixServer::~PosixServer()
+{
+   if (_Socket >= 0)
+   {
+      close(_Socket);
+   }
+}
+
+bool PosixServer::begin()
+{
+   _Socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+   if (_Socket < 0)
+   {
+      return false;
+   }
+   int iReuse = 1;
+   setsockopt(_Socket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+
+   sockaddr_in Address = {};
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(INADDR_ANY);
+   Address.sin_port = htons(_Port);
+   if (bind(_Socket, (sockaddr *)&Address, sizeof(Address)) < 0 || listen(_Socket, SOMAXCONN) < 0)
+   {
+      close(_Socket);
+      _Socket = -1;
+      return false;
+   }
+   return true;
+}
+
+PosixClient PosixServer::available()
+{
+   if (_Socket < 0)
+   {
+      return PosixClient();
+   }
+   int iClientSocket = accept4(_Socket, NULL, NULL, SOCK_NONBLOCK);
+   if (iClientSocket < 0)
+   {
+      return PosixClient();
+   }
+   OpenSockets.insert(iClientSocket);
+   PosixClient Client(iClientSocket);
+   Client.setNoDelay(_bNoDelay);
+   return Client;
+}
+
+void PosixServer::wait(int iTimeoutMs)
+{
+   std::vector<pollfd> Sockets;
+   Sockets.push_back({_Socket, POLLIN, 0});
+   for (int iSocket : OpenSockets)
+   {
+      Sockets.push_back({iSocket, POLLIN, 0});
+   }
+   poll(Sockets.data(), Sockets.size(), iTimeoutMs);
+}
+
+uint8_t PosixUdp::begin(uint16_t port)
+{
+   stop();
+   _Socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+   if (_Socket < 0)
+   {
+      return 0;
+   }
+   //Several host programs may listen for the same broadcast or multicast packets
+   int iReuse = 1;
+   setsockopt(_Socket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+
+   sockaddr_in Address = {};
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(INADDR_ANY);
+   Address.sin_port = htons(port);
+   if (bind(_Socket, (sockaddr *)&Address, sizeof(Address)) < 0)
+   {
+      close(_Socket);
+      _Socket = -1;
+      return 0;
+   }
+   OpenSockets.insert(_Socket);
+   return 1;
+}
+
+uint8_t PosixUdp::beginMulticast(IPAddress interfaceAddr, IPAddress multicast, uint16_t port)
+{
+   if (!begin(port))
+   {
+      return 0;
+   }
+   ip_mreq Membership = {};
+   Membership.imr_multiaddr.s_addr = inet_addr(multicast.toString().c_str());
+   Membership.imr_interface.s_addr = inet_addr(interfaceAddr.toString().c_str());
+   if (setsockopt(_Socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &Membership, sizeof(Membership)) < 0)
+   {
+      stop();
+      return 0;
+   }
+   return 1;
+}
+
+void PosixUdp::stop()
+{
+   if (_Socket < 0)
+   {
+      return;
+   }
+   OpenSockets.erase(_Socket);
+   close(_Socket);
+   _Socket = -1;
+}
+
+int PosixUdp::parsePacket()
+{
+   _Size = 0;
+   _Position = 0;
+   if (_Socket < 0)
+   {
+      return 0;
+   }
+   //MSG_TRUNC reports the real size of a packet which didn't fit, like WiFiUDP does
+   ssize_t Result = recv(_Socket, _Packet, sizeof(_Packet), MSG_DONTWAIT | MSG_TRUNC);
+   if (Result <= 0)
+   {
+      return 0;
+   }
+   _Size = std::min<ssize_t>(Result, sizeof(_Packet));
+   return Result;
+}
+
+int PosixUdp::read(uint8_t *buffer, size_t len)
+{
+   int iCount = std::min<int>(len, available());
+   memcpy(buffer, _Packet + _Position, iCount);
+   _Position += iCount;
+   return iCount;
+}
@@ -0,0 +1,95 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//NetworkServer transport on non-blocking POSIX sockets, so the server code can run as a plain Linux process.
+//Only built for host programs, the board environments ignore this library.
+
+#ifndef _PosixTransport_h
+#define _PosixTransport_h
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+//Accepted TCP connection, copies refer to the same socket like WiFiClient copies do
+class PosixClient
+{
+public:
+   PosixClient() {}
+   explicit PosixClient(int Socket) : _Socket(Socket) {}
+
+   uint8_t connected();
+   int available();
+   int read(uint8_t *buffer, size_t size);
+   size_t write(const uint8_t *buffer, size_t size);
+   void stop();
+   void setNoDelay(bool nodelay);
+
+private:
+   int _Socket = -1;
+};
+
+class PosixServer
+{
+public:
+   PosixServer(uint16_t port) : _Port(port) {}
+   ~PosixServer();
+
+   //Returns false if the port can't be opened
+   bool begin();
+   //Returns the next pending connection, or a client which is not connected if there is none
+   PosixClient available();
+   void setNoDelay(bool nodelay) { _bNoDelay = nodelay; }
+   //Blocks up to iTimeoutMs until a connection is pending or an accepted client has data or closed,
+   //lets a host program sleep instead of spinning on Loop()
+   void wait(int iTimeoutMs);
+
+private:
+   uint16_t _Port;
+   int _Socket = -1;
+   bool _bNoDelay = false;
+};
+
+//UDP socket shaped like WiFiUDP, wait() also wakes up for its packets
+class PosixUdp
+{
+public:
+   ~PosixUdp() { stop(); }
+
+   uint8_t begin(uint16_t port);
+   uint8_t beginMulticast(IPAddress interfaceAddr, IPAddress multicast, uint16_t port);
+   void stop();
+   //Receives the next packet and returns its size, or 0 if there is none
+   int parsePacket();
+   int available() { return _Size - _Position; }
+   int read(uint8_t *buffer, size_t len);
+
+private:
+   int _Socket = -1;
+   uint8_t _Packet[1500];
+   int _Size = 0;
+   int _Position = 0;
+};
+
+struct PosixTransport
+{
+   typedef PosixServer Server;
+   typedef PosixClient Client;
+   typedef PosixUdp Udp;
+};
+
+#endif
@@ -0,0 +1,25 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SegmentFont.h"
+
+const SegmentGlyphTable SegmentGlyphs PROGMEM = BuildSegmentGlyphTable<DisplayWiring>();
+
+//The wiring must keep the glyphs the display has always shown
+static_assert(BuildSegmentGlyphTable<DisplayWiring>().Glyphs[8] == 0x7F, "8 must light all segments but the decimal point");
+static_assert(BuildSegmentGlyphTable<DisplayWiring>().Glyphs['c'] == ((1 << 2) | (1 << 3) | (1 << 4)), "c must light segments G, E and D");
@@ -0,0 +1,224 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SegmentFont_h
+#define _SegmentFont_h
+
+#include <Arduino.h>
+
+//    -  A
+//   / / F/B
+//    -  G
+//   / / E/C
+//    -. D/DP
+
+//Canonical segment bits, only used to describe glyphs. The bits sent to the display are set by the wiring below.
+#define SEG_A (1 << 0)
+#define SEG_B (1 << 1)
+#define SEG_C (1 << 2)
+#define SEG_D (1 << 3)
+#define SEG_E (1 << 4)
+#define SEG_F (1 << 5)
+#define SEG_G (1 << 6)
+#define SEG_DP (1 << 7)
+
+//Shift register output (bit) each segment is wired to
+template <uint8_t A, uint8_t B, uint8_t C, uint8_t D, uint8_t E, uint8_t F, uint8_t G, uint8_t DP>
+struct SegmentWiring
+{
+   //Translates canonical segment bits to shift register bits
+   static constexpr uint8_t Map(uint8_t Canonical)
+   {
+      return ((Canonical & SEG_A) ? 1 << A : 0) | ((Canonical & SEG_B) ? 1 << B : 0) | ((Canonical & SEG_C) ? 1 << C : 0) |
+             ((Canonical & SEG_D) ? 1 << D : 0) | ((Canonical & SEG_E) ? 1 << E : 0) | ((Canonical & SEG_F) ? 1 << F : 0) |
+             ((Canonical & SEG_G) ? 1 << G : 0) | ((Canonical & SEG_DP) ? 1 << DP : 0);
+   }
+
+   //Translates shift register bits back to canonical segment bits
+   static constexpr uint8_t Unmap(uint8_t Bits)
+   {
+      return ((Bits & (1 << A)) ? SEG_A : 0) | ((Bits & (1 << B)) ? SEG_B : 0) | ((Bits & (1 << C)) ? SEG_C : 0) |
+             ((Bits & (1 << D)) ? SEG_D : 0) | ((Bits & (1 << E)) ? SEG_E : 0) | ((Bits & (1 << F)) ? SEG_F : 0) |
+             ((Bits & (1 << G)) ? SEG_G : 0) | ((Bits & (1 << DP)) ? SEG_DP : 0);
+   }
+};
+
+//Wiring of the TPIC6B595 driver board, change the display wiring here
+typedef SegmentWiring<0, 6, 5, 4, 3, 1, 2, 7> DisplayWiring;
+
+//Canonical glyph for a character, characters without a glyph are blank.
+//Values 0-9 are the digits themselves so a number can be looked up without converting it to ASCII first.
+constexpr uint8_t CanonicalGlyph(uint8_t Character)
+{
+   if (Character <= 9)
+   {
+      Character += '0';
+   }
+   switch (Character)
+   {
+   case '0':
+   case 'O':
+      return SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F;
+   case '1':
+      return SEG_B | SEG_C;
+   case '2':
+      return SEG_A | SEG_B | SEG_D | SEG_E | SEG_G;
+   case '3':
+      return SEG_A | SEG_B | SEG_C | SEG_D | SEG_G;
+   case '4':
+      return SEG_B | SEG_C | SEG_F | SEG_G;
+   case '5':
+   case 'S':
+   case 's':
+      return SEG_A | SEG_C | SEG_D | SEG_F | SEG_G;
+   case '6':
+      return SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G;
+   case '7':
+      return SEG_A | SEG_B | SEG_C;
+   case '8':
+      return SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G;
+   case '9':
+      return SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G;
+   case 'A':
+   case 'a':
+      return SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G;
+   case 'b':
+   case 'B':
+      return SEG_C | SEG_D | SEG_E | SEG_F | SEG_G;
+   case 'C':
+      return SEG_A | SEG_D | SEG_E | SEG_F;
+   case 'c':
+      return SEG_D | SEG_E | SEG_G;
+   case 'd':
+   case 'D':
+      return SEG_B | SEG_C | SEG_D | SEG_E | SEG_G;
+   case 'E':
+   case 'e':
+      return SEG_A | SEG_D | SEG_E | SEG_F | SEG_G;
+   case 'F':
+   case 'f':
+      return SEG_A | SEG_E | SEG_F | SEG_G;
+   case 'G':
+   case 'g':
+      return SEG_A | SEG_C | SEG_D | SEG_E | SEG_F;
+   case 'H':
+      return SEG_B | SEG_C | SEG_E | SEG_F | SEG_G;
+   case 'h':
+      return SEG_C | SEG_E | SEG_F | SEG_G;
+   case 'I':
+      return SEG_E | SEG_F;
+   case 'i':
+      return SEG_C;
+   case 'J':
+   case 'j':
+      return SEG_B | SEG_C | SEG_D | SEG_E;
+   case 'L':
+   case 'l':
+      return SEG_D | SEG_E | SEG_F;
+   case 'n':
+   case 'N':
+      return SEG_C | SEG_E | SEG_G;
+   case 'o':
+      return SEG_C | SEG_D | SEG_E | SEG_G;
+   case 'P':
+   case 'p':
+      return SEG_A | SEG_B | SEG_E | SEG_F | SEG_G;
+   case 'q':
+   case 'Q':
+      return SEG_A | SEG_B | SEG_C | SEG_F | SEG_G;
+   case 'r':
+   case 'R':
+      return SEG_E | SEG_G;
+   case 't':
+   case 'T':
+      return SEG_D | SEG_E | SEG_F | SEG_G;
+   case 'U':
+      return SEG_B | SEG_C | SEG_D | SEG_E | SEG_F;
+   case 'u':
+      return SEG_C | SEG_D | SEG_E;
+   case 'y':
+   case 'Y':
+      return SEG_B | SEG_C | SEG_D | SEG_F | SEG_G;
+   case '-':
+      return SEG_G;
+   case '_':
+      return SEG_D;
+   case '=':
+      return SEG_D | SEG_G;
+   default:
+      return 0;
+   }
+}
+
+//Character a canonical glyph (without decimal point) reads as, '?' if no character has that glyph.
+//Digits go before letters with the same glyph, so a 0 or 5 reads as a digit.
+inline char GlyphCharacter(uint8_t Canonical)
+{
+   if (Canonical == 0)
+   {
+      return ' ';
+   }
+   for (uint8_t c = 0; c <= 9; c++)
+   {
+      if (CanonicalGlyph(c) == Canonical)
+      {
+         return '0' + c;
+      }
+   }
+   for (uint8_t c = '!'; c <= '~'; c++)
+   {
+      if (CanonicalGlyph(c) == Canonical)
+      {
+         return c;
+      }
+   }
+   return '?';
+}
+
+#define SEGMENT_GLYPH_COUNT 128
+
+struct SegmentGlyphTable
+{
+   uint8_t Glyphs[SEGMENT_GLYPH_COUNT];
+};
+
+//Builds the complete lookup table for a wiring at compile time
+template <typename Wiring>
+constexpr SegmentGlyphTable BuildSegmentGlyphTable()
+{
+   SegmentGlyphTable Table = {};
+   for (uint8_t i = 0; i < SEGMENT_GLYPH_COUNT; i++)
+   {
+      Table.Glyphs[i] = Wiring::Map(CanonicalGlyph(i));
+   }
+   return Table;
+}
+
+//Glyph table for DisplayWiring, lives in flash
+extern const SegmentGlyphTable SegmentGlyphs;
+
+//Shift register bits for a character or a digit value (0-9)
+inline uint8_t SegmentGlyph(uint8_t Character)
+{
+   return pgm_read_byte(&SegmentGlyphs.Glyphs[Character & (SEGMENT_GLYPH_COUNT - 1)]);
+}
+
+//Shift register bit of the decimal point
+constexpr uint8_t SEGMENT_DECIMAL_POINT = DisplayWiring::Map(SEG_DP);
+
+#endif
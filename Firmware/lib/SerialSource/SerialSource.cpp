@@ -0,0 +1,75 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SerialSource.h"
+#include <Log.h>
+
+void SerialSource::init(Stream *Port, CommandQueue *Queue)
+{
+   _Port = Port;
+   _Queue = Queue;
+}
+
+void SerialSource::Loop()
+{
+   size_t Budget = SERIAL_LOOP_BYTE_BUDGET;
+   while (Budget > 0 && !_ReceiveBuffer.IsFull() && _Port->available() > 0)
+   {
+      char cInChar = _Port->read();
+      Budget--;
+      if (_bDiscarding)
+      {
+         _bDiscarding = cInChar != '\n';
+         continue;
+      }
+      _ReceiveBuffer.Push(cInChar);
+   }
+
+   _QueueMessages();
+
+   if (_ReceiveBuffer.IsFull() && !_ReceiveBuffer.HasLine())
+   {
+      //No room left for the end of the line, drop it up to the next newline
+      LOG_WARN("Serial line longer than %i bytes, discarding it\r\n", SERIAL_BUFFER_SIZE);
+      _ReceiveBuffer.Clear();
+      _bDiscarding = true;
+      _ulOverflows++;
+   }
+}
+
+void SerialSource::_QueueMessages()
+{
+   QueuedMessage *Message;
+   //Lines stay in the buffer while the queue is full
+   while (_ReceiveBuffer.HasLine() && (Message = _Queue->Reserve()) != NULL)
+   {
+      Message->iSource = SERIAL_MESSAGE_SOURCE;
+      Message->iSequence = _iNextSequence++;
+      Message->Type = MESSAGE_TEXT;
+      Message->iLength = 0;
+      Message->ulArrivalMicros = micros();
+      if (!_ReceiveBuffer.PopLine(Message->szData, sizeof(Message->szData)))
+      {
+         //Never run the first part of a line, it could still be a valid command
+         LOG_WARN("Serial line longer than %i characters, discarding it\r\n", MESSAGE_MAX_LENGTH - 1);
+         _ulOverflows++;
+         continue;
+      }
+      _Queue->Commit();
+   }
+}
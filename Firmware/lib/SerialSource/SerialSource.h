@@ -0,0 +1,53 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Input source for commands typed or sent on the serial port, see MessageQueue.h. Lines are framed in a buffer of the
+//source's own, so a partly received line is never mixed with network messages, and only complete lines are queued.
+//Loop() reads what the UART has received without waiting and never flushes or writes to it.
+
+#ifndef _SerialSource_h
+#define _SerialSource_h
+
+#include <Arduino.h>
+#include <LineBuffer.h>
+#include <MessageQueue.h>
+
+#define SERIAL_MESSAGE_SOURCE 0xFE //QueuedMessage::iSource of messages received on the serial port
+#define SERIAL_BUFFER_SIZE 64       //Must be a power of 2, lines longer than MESSAGE_MAX_LENGTH - 1 are dropped
+#define SERIAL_LOOP_BYTE_BUDGET 64  //Bytes read in one Loop(), the rest waits in the UART buffer
+
+class SerialSource
+{
+public:
+   void init(Stream *Port, CommandQueue *Queue);
+   void Loop();
+   //Lines dropped for not fitting a queued message
+   unsigned long GetOverflowCount() const { return _ulOverflows; }
+
+private:
+   Stream *_Port = NULL;
+   CommandQueue *_Queue = NULL;
+   LineBuffer<SERIAL_BUFFER_SIZE> _ReceiveBuffer;
+   bool _bDiscarding = false; //Dropping the rest of a line that didn't fit
+   uint16_t _iNextSequence = 0;
+   unsigned long _ulOverflows = 0;
+
+   void _QueueMessages();
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Stopwatch.h"
+
+void Stopwatch::Start(unsigned long ulOffsetHundredths)
+{
+   _ullElapsedMicros = (uint64_t)ulOffsetHundredths * 10000;
+   _ulLastMicros = micros();
+   _bRunning = true;
+}
+
+void Stopwatch::Stop()
+{
+   Update();
+   _bRunning = false;
+}
+
+void Stopwatch::Finish(unsigned long ulHundredths)
+{
+   _ullElapsedMicros = (uint64_t)ulHundredths * 10000;
+   _bRunning = false;
+}
+
+void Stopwatch::Reset()
+{
+   _ullElapsedMicros = 0;
+   _bRunning = false;
+}
+
+unsigned long Stopwatch::Update()
+{
+   if (_bRunning)
+   {
+      //Unsigned subtraction gives the right interval across a micros() rollover
+      unsigned long ulNow = micros();
+      _ullElapsedMicros += (uint32_t)(ulNow - _ulLastMicros);
+      _ulLastMicros = ulNow;
+   }
+   return GetHundredths();
+}
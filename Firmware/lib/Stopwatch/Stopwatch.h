@@ -0,0 +1,51 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _Stopwatch_h
+#define _Stopwatch_h
+
+#include <Arduino.h>
+
+//Count up timer with hundredths of a second resolution, driven by micros().
+//Elapsed time is added up in 64 bits on every Update(), so micros() rolling over (every ~71 minutes)
+//doesn't matter as long as Update() is called more often than that.
+class Stopwatch
+{
+public:
+   //Starts counting from ulOffsetHundredths, e.g. to make up for the time the start command was underway
+   void Start(unsigned long ulOffsetHundredths);
+   //Freezes the time where it is
+   void Stop();
+   //Freezes the time on a value from the timing system
+   void Finish(unsigned long ulHundredths);
+   void Reset();
+
+   bool IsRunning() const { return _bRunning; }
+   //Brings the time up to date and returns it
+   unsigned long Update();
+   unsigned long GetHundredths() const { return _ullElapsedMicros / 10000; }
+   //Time until the shown hundredth changes, as of the last Update()
+   unsigned long GetMicrosToNextHundredth() const { return 10000 - _ullElapsedMicros % 10000; }
+
+private:
+   bool _bRunning = false;
+   unsigned long _ulLastMicros = 0;
+   uint64_t _ullElapsedMicros = 0;
+};
+
+#endif
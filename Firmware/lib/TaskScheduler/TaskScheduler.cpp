@@ -0,0 +1,146 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TaskScheduler.h"
+#include <Log.h>
+
+uint8_t TaskScheduler::Add(const char *szName, TaskCallback Callback, uint32_t ulPeriodMicros)
+{
+   if (_iTaskCount >= TASK_SCHEDULER_MAX_TASKS)
+   {
+      LOG_ERROR("No room for task %s\r\n", szName);
+      return TASK_INVALID;
+   }
+   _Task &Task = _Tasks[_iTaskCount];
+   Task.szName = szName;
+   Task.Callback = Callback;
+   Task.ulPeriodMicros = ulPeriodMicros;
+   Task.ulDueMicros = micros() + ulPeriodMicros;
+   Task.bScheduled = ulPeriodMicros > 0;
+   memset(&Task.Stats, 0, sizeof(Task.Stats));
+   return _iTaskCount++;
+}
+
+void TaskScheduler::RunAt(uint8_t iTask, uint32_t ulDueMicros)
+{
+   if (iTask >= _iTaskCount)
+   {
+      return;
+   }
+   _Tasks[iTask].ulDueMicros = ulDueMicros;
+   _Tasks[iTask].bScheduled = true;
+}
+
+void TaskScheduler::Stop(uint8_t iTask)
+{
+   if (iTask < _iTaskCount)
+   {
+      _Tasks[iTask].bScheduled = false;
+   }
+}
+
+uint32_t TaskScheduler::Loop()
+{
+   for (uint8_t i = 0; i < _iTaskCount; i++)
+   {
+      _Task &Task = _Tasks[i];
+      uint32_t ulStart = micros();
+      int32_t lLate = (int32_t)(ulStart - Task.ulDueMicros);
+      if (!Task.bScheduled || lLate < 0)
+      {
+         continue;
+      }
+
+      //Pick the next deadline before the call, so the task can still move it
+      if (Task.ulPeriodMicros > 0)
+      {
+         Task.ulDueMicros += Task.ulPeriodMicros;
+         if ((int32_t)(ulStart - Task.ulDueMicros) >= 0)
+         {
+            //Fell more than a period behind, skip the missed runs instead of running them back to back
+            uint32_t ulMissed = (ulStart - Task.ulDueMicros) / Task.ulPeriodMicros + 1;
+            Task.Stats.ulSkipped += ulMissed;
+            Task.ulDueMicros += ulMissed * Task.ulPeriodMicros;
+         }
+      }
+      else
+      {
+         Task.bScheduled = false;
+      }
+
+      Task.Callback();
+
+      uint32_t ulRunTime = micros() - ulStart;
+      Task.Stats.ulRuns++;
+      Task.Stats.ulRunMicros += ulRunTime;
+      Task.Stats.ulLateMicros += lLate;
+      if (ulRunTime > Task.Stats.ulMaxRunMicros)
+      {
+         Task.Stats.ulMaxRunMicros = ulRunTime;
+      }
+      if ((unsigned long)lLate > Task.Stats.ulMaxLateMicros)
+      {
+         Task.Stats.ulMaxLateMicros = lLate;
+      }
+   }
+   return GetMicrosToNextTask();
+}
+
+uint32_t TaskScheduler::GetMicrosToNextTask() const
+{
+   uint32_t ulNow = micros();
+   uint32_t ulNext = TASK_IDLE_MAX;
+   for (uint8_t i = 0; i < _iTaskCount; i++)
+   {
+      if (!_Tasks[i].bScheduled)
+      {
+         continue;
+      }
+      int32_t lLeft = (int32_t)(_Tasks[i].ulDueMicros - ulNow);
+      if (lLeft <= 0)
+      {
+         return 0;
+      }
+      if ((uint32_t)lLeft < ulNext)
+      {
+         ulNext = lLeft;
+      }
+   }
+   return ulNext;
+}
+
+void TaskScheduler::ResetStats()
+{
+   for (uint8_t i = 0; i < _iTaskCount; i++)
+   {
+      memset(&_Tasks[i].Stats, 0, sizeof(_Tasks[i].Stats));
+   }
+}
+
+void TaskScheduler::LogStats()
+{
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+   for (uint8_t i = 0; i < _iTaskCount; i++)
+   {
+      const TaskStats &Stats = _Tasks[i].Stats;
+      LOG_INFO("Task %s: %lu runs, %lu skipped | run avg %lu max %lu us | late avg %lu max %lu us\r\n", _Tasks[i].szName, Stats.ulRuns,
+               Stats.ulSkipped, Stats.ulRuns ? Stats.ulRunMicros / Stats.ulRuns : 0, Stats.ulMaxRunMicros,
+               Stats.ulRuns ? Stats.ulLateMicros / Stats.ulRuns : 0, Stats.ulMaxLateMicros);
+   }
+#endif
+}
@@ -0,0 +1,83 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Cooperative scheduler for the jobs loop() runs on a timer. A task is due at a micros() time, either every
+//period or at a time set with RunAt()/RunIn(), and Loop() only calls the tasks that are due.
+//Deadlines are compared with signed 32 bit differences, so they work across the micros() rollover (every ~71 minutes)
+//as long as no deadline is more than ~35 minutes away.
+
+#ifndef _TaskScheduler_h
+#define _TaskScheduler_h
+
+#include <Arduino.h>
+
+#define TASK_SCHEDULER_MAX_TASKS 16
+#define TASK_INVALID 0xFF
+#define TASK_IDLE_MAX 0x7FFFFFFFUL //GetMicrosToNextTask() with nothing scheduled
+
+typedef void (*TaskCallback)();
+
+struct TaskStats
+{
+   unsigned long ulRuns;
+   unsigned long ulSkipped;     //Periods missed completely because the task or loop() was too slow
+   unsigned long ulRunMicros;   //Total time spent in the task
+   unsigned long ulMaxRunMicros;
+   unsigned long ulLateMicros;  //Total time between deadline and start
+   unsigned long ulMaxLateMicros;
+};
+
+class TaskScheduler
+{
+public:
+   //Adds a task and returns its handle, TASK_INVALID if all slots are taken.
+   //With a period the task first runs one period from now, without one it only runs when RunAt()/RunIn() says so.
+   uint8_t Add(const char *szName, TaskCallback Callback, uint32_t ulPeriodMicros = 0);
+
+   //Sets the next run, a task may call these on itself to pick its own next deadline
+   void RunAt(uint8_t iTask, uint32_t ulDueMicros);
+   void RunIn(uint8_t iTask, uint32_t ulDelayMicros) { RunAt(iTask, micros() + ulDelayMicros); }
+   void Stop(uint8_t iTask);
+   bool IsScheduled(uint8_t iTask) const { return iTask < _iTaskCount && _Tasks[iTask].bScheduled; }
+
+   //Runs every due task and returns the time until the next deadline
+   uint32_t Loop();
+   //Time until the next deadline, 0 if a task is due, TASK_IDLE_MAX if none is scheduled
+   uint32_t GetMicrosToNextTask() const;
+
+   uint8_t GetTaskCount() const { return _iTaskCount; }
+   const char *GetName(uint8_t iTask) const { return _Tasks[iTask].szName; }
+   const TaskStats &GetStats(uint8_t iTask) const { return _Tasks[iTask].Stats; }
+   void ResetStats();
+   void LogStats();
+
+private:
+   struct _Task
+   {
+      const char *szName;
+      TaskCallback Callback;
+      uint32_t ulPeriodMicros;
+      uint32_t ulDueMicros;
+      bool bScheduled;
+      TaskStats Stats;
+   };
+   _Task _Tasks[TASK_SCHEDULER_MAX_TASKS];
+   uint8_t _iTaskCount = 0;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Connectionless update channel next to the port 23 server, so one packet can drive a group of displays at once.
+//Every packet holds exactly one message behind a short text header:
+//
+//   <group>:<sequence>:<message>
+//
+//group 0 addresses every display, 1-255 only the displays configured for that group.
+//sequence counts up from the sender (0-65535, wrapping), packets which are not newer than the last accepted one
+//are dropped, so a late or duplicated packet can't put an old value back on the display.
+//message is a text command exactly as on port 23 (a trailing \n is optional) or a binary frame, see BinaryFrame.h.
+//The firmware refuses RSTNW from this source, since packets aren't authenticated.
+//Nothing is sent back, the sender can't tell which displays received a packet.
+
+#ifndef _UdpListener_h
+#define _UdpListener_h
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include <ESP8266WiFi.h>
+#include <MessageQueue.h>
+#include <BinaryFrame.h>
+#include <Log.h>
+
+#define UDP_BROADCAST_GROUP 0
+#define UDP_MESSAGE_SOURCE 0xFF //QueuedMessage::iSource of messages received over UDP
+#define UDP_MAX_PACKET 64       //Header and message, longer packets are dropped
+#ifndef UDP_SEQUENCE_TIMEOUT
+#define UDP_SEQUENCE_TIMEOUT 5000 //After this long (ms) without a packet any sequence number is accepted, so a restarted sender isn't locked out
+#endif
+#ifndef UDP_LOOP_PACKET_BUDGET
+#define UDP_LOOP_PACKET_BUDGET 8 //Packets read in one GetMessage() call while looking for one for this display
+#endif
+
+struct UdpListenerStats
+{
+   unsigned long ulAccepted = 0;
+   unsigned long ulStale = 0;      //Late or duplicated sequence numbers
+   unsigned long ulOtherGroup = 0;
+   unsigned long ulInvalid = 0;    //Bad header or message, or too long
+};
+
+//A transport is a struct with a Udp type shaped like WiFiUDP, see WiFiTransport.h and lib/PosixTransport
+template <class Transport>
+class UdpListener
+{
+   static_assert(BINARY_FRAME_MAX_BODY <= MESSAGE_MAX_LENGTH, "A binary frame body must fit in a queued message");
+
+public:
+   bool begin(uint16_t Port, uint8_t iGroup);
+   bool beginMulticast(IPAddress Interface, IPAddress Multicast, uint16_t Port, uint8_t iGroup);
+   //Reads packets until one is meant for this display, returns false if none is waiting
+   bool GetMessage(QueuedMessage &Message);
+   uint8_t GetGroup() const { return _iGroup; }
+   const UdpListenerStats &GetStats() const { return _Stats; }
+
+private:
+   typename Transport::Udp _Udp;
+   uint8_t _iGroup = UDP_BROADCAST_GROUP;
+   bool _bStarted = false;
+   bool _bSequenceValid = false;
+   uint16_t _iLastSequence = 0;
+   unsigned long _ulLastPacketTime = 0;
+   BinaryFrameReader _FrameReader;
+   UdpListenerStats _Stats;
+
+   //Returns the number of header bytes, or 0 if the header is invalid
+   static size_t _ParseHeader(const uint8_t *Packet, size_t Length, uint8_t &iGroup, uint16_t &iSequence);
+   static size_t _ParseField(const uint8_t *Data, size_t Length, unsigned long ulMax, unsigned long &ulValue);
+   bool _IsNewer(uint16_t iSequence);
+   bool _FillMessage(const uint8_t *Data, size_t Length, QueuedMessage &Message);
+};
+
+template <class Transport>
+bool UdpListener<Transport>::begin(uint16_t Port, uint8_t iGroup)
+{
+   _iGroup = iGroup;
+   _bStarted = _Udp.begin(Port);
+   LOG_INFO("UDP listener on port %u, group %u: %s\r\n", Port, iGroup, _bStarted ? "started" : "failed");
+   return _bStarted;
+}
+
+template <class Transport>
+bool UdpListener<Transport>::beginMulticast(IPAddress Interface, IPAddress Multicast, uint16_t Port, uint8_t iGroup)
+{
+   _iGroup = iGroup;
+   _bStarted = _Udp.beginMulticast(Interface, Multicast, Port);
+   LOG_INFO("UDP listener on %s:%u, group %u: %s\r\n", Multicast.toString().c_str(), Port, iGroup, _bStarted ? "started" : "failed");
+   return _bStarted;
+}
+
+template <class Transport>
+bool UdpListener<Transport>::GetMessage(QueuedMessage &Message)
+{
+   if (!_bStarted)
+   {
+      return false;
+   }
+
+   for (int i = 0; i < UDP_LOOP_PACKET_BUDGET; i++)
+   {
+      int iSize = _Udp.parsePacket();
+      if (iSize <= 0)
+      {
+         return false;
+      }
+
+      uint8_t Packet[UDP_MAX_PACKET];
+      if (iSize > UDP_MAX_PACKET)
+      {
+         //The rest of the packet is discarded by the next parsePacket()
+         _Stats.ulInvalid++;
+         LOG_WARN("UDP packet of %i bytes dropped, too long\r\n", iSize);
+         continue;
+      }
+      size_t Length = _Udp.read(Packet, iSize);
+
+      uint8_t iGroup;
+      uint16_t iSequence;
+      size_t HeaderLength = _ParseHeader(Packet, Length, iGroup, iSequence);
+      if (HeaderLength == 0)
+      {
+         _Stats.ulInvalid++;
+         LOG_WARN("UDP packet with invalid header dropped\r\n");
+         continue;
+      }
+      if (iGroup != UDP_BROADCAST_GROUP && iGroup != _iGroup)
+      {
+         _Stats.ulOtherGroup++;
+         continue;
+      }
+      if (!_IsNewer(iSequence))
+      {
+         _Stats.ulStale++;
+         LOG_DEBUG("UDP packet %u dropped, last was %u\r\n", iSequence, _iLastSequence);
+         continue;
+      }
+      if (!_FillMessage(Packet + HeaderLength, Length - HeaderLength, Message))
+      {
+         _Stats.ulInvalid++;
+         LOG_WARN("UDP packet %u with invalid message dropped\r\n", iSequence);
+         continue;
+      }
+
+      _bSequenceValid = true;
+      _iLastSequence = iSequence;
+      _ulLastPacketTime = millis();
+      Message.iSequence = iSequence;
+      _Stats.ulAccepted++;
+      return true;
+   }
+   return false;
+}
+
+template <class Transport>
+size_t UdpListener<Transport>::_ParseHeader(const uint8_t *Packet, size_t Length, uint8_t &iGroup, uint16_t &iSequence)
+{
+   unsigned long ulGroup, ulSequence;
+   size_t GroupLength = _ParseField(Packet, Length, 255, ulGroup);
+   if (GroupLength == 0)
+   {
+      return 0;
+   }
+   size_t SequenceLength = _ParseField(Packet + GroupLength, Length - GroupLength, 65535, ulSequence);
+   if (SequenceLength == 0)
+   {
+      return 0;
+   }
+   iGroup = ulGroup;
+   iSequence = ulSequence;
+   return GroupLength + SequenceLength;
+}
+
+//Parses "<decimal number>:", returns the number of bytes used or 0 if the field is invalid
+template <class Transport>
+size_t UdpListener<Transport>::_ParseField(const uint8_t *Data, size_t Length, unsigned long ulMax, unsigned long &ulValue)
+{
+   ulValue = 0;
+   size_t i = 0;
+   while (i < Length && i < 5 && Data[i] >= '0' && Data[i] <= '9')
+   {
+      ulValue = ulValue * 10 + (Data[i] - '0');
+      i++;
+   }
+   if (i == 0 || i >= Length || Data[i] != ':' || ulValue > ulMax)
+   {
+      return 0;
+   }
+   return i + 1;
+}
+
+//Sequence numbers are compared with wrap around, a packet is newer if it is less than half the number space ahead
+template <class Transport>
+bool UdpListener<Transport>::_IsNewer(uint16_t iSequence)
+{
+   if (!_bSequenceValid || millis() - _ulLastPacketTime >= UDP_SEQUENCE_TIMEOUT)
+   {
+      return true;
+   }
+   return (int16_t)(iSequence - _iLastSequence) > 0;
+}
+
+template <class Transport>
+bool UdpListener<Transport>::_FillMessage(const uint8_t *Data, size_t Length, QueuedMessage &Message)
+{
+   Message.iSource = UDP_MESSAGE_SOURCE;
+   Message.ulArrivalMicros = micros();
+
+   if (Length > 0 && Data[0] == BINARY_FRAME_START)
+   {
+      //The frame must fill the rest of the packet exactly
+      _FrameReader.Reset();
+      BinaryFrameResult Result = BINARY_FRAME_INCOMPLETE;
+      size_t i = 0;
+      while (i < Length && Result == BINARY_FRAME_INCOMPLETE)
+      {
+         Result = _FrameReader.Push(Data[i++]);
+      }
+      if (Result != BINARY_FRAME_COMPLETE || i != Length)
+      {
+         _FrameReader.Reset();
+         return false;
+      }
+      Message.Type = MESSAGE_BINARY;
+      Message.iLength = _FrameReader.BodyLength();
+      memcpy(Message.szData, _FrameReader.Body(), Message.iLength);
+      return true;
+   }
+
+   if (Length > 0 && Data[Length - 1] == '\n')
+   {
+      Length--;
+   }
+   if (Length == 0 || Length >= MESSAGE_MAX_LENGTH || memchr(Data, '\n', Length) != NULL)
+   {
+      return false;
+   }
+   Message.Type = MESSAGE_TEXT;
+   Message.iLength = 0;
+   memcpy(Message.szData, Data, Length);
+   Message.szData[Length] = '\0';
+   return true;
+}
+
+#endif
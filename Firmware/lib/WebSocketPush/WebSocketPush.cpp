@@ -0,0 +1,122 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WebSocketPush.h"
+
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+static uint32_t RotateLeft(uint32_t Value, uint8_t Bits)
+{
+   return (Value << Bits) | (Value >> (32 - Bits));
+}
+
+//SHA-1 of a message short enough for two 64 byte blocks, which the key and GUID always are
+static void Sha1(const uint8_t *Data, size_t Length, uint8_t *Digest)
+{
+   uint8_t Blocks[128] = {};
+   size_t BlockBytes = Length + 9 <= 64 ? 64 : 128;
+   memcpy(Blocks, Data, Length);
+   Blocks[Length] = 0x80;
+   uint64_t ullBits = (uint64_t)Length * 8;
+   for (uint8_t i = 0; i < 8; i++)
+   {
+      Blocks[BlockBytes - 1 - i] = ullBits >> (8 * i);
+   }
+
+   uint32_t H[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+   for (size_t Block = 0; Block < BlockBytes; Block += 64)
+   {
+      uint32_t W[80];
+      for (uint8_t t = 0; t < 16; t++)
+      {
+         const uint8_t *p = &Blocks[Block + t * 4];
+         W[t] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+      }
+      for (uint8_t t = 16; t < 80; t++)
+      {
+         W[t] = RotateLeft(W[t - 3] ^ W[t - 8] ^ W[t - 14] ^ W[t - 16], 1);
+      }
+
+      uint32_t a = H[0], b = H[1], c = H[2], d = H[3], e = H[4];
+      for (uint8_t t = 0; t < 80; t++)
+      {
+         uint32_t f, k;
+         if (t < 20)
+         {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+         }
+         else if (t < 40)
+         {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+         }
+         else if (t < 60)
+         {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+         }
+         else
+         {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+         }
+         uint32_t Temp = RotateLeft(a, 5) + f + e + k + W[t];
+         e = d;
+         d = c;
+         c = RotateLeft(b, 30);
+         b = a;
+         a = Temp;
+      }
+      H[0] += a;
+      H[1] += b;
+      H[2] += c;
+      H[3] += d;
+      H[4] += e;
+   }
+
+   for (uint8_t i = 0; i < 20; i++)
+   {
+      Digest[i] = H[i / 4] >> (24 - 8 * (i % 4));
+   }
+}
+
+void WebSocketAcceptKey(const char *szKey, char *szAccept)
+{
+   static const char Base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+   uint8_t Input[WEBSOCKET_KEY_LENGTH + sizeof(WEBSOCKET_GUID) - 1];
+   size_t KeyLength = strnlen(szKey, WEBSOCKET_KEY_LENGTH);
+   memcpy(Input, szKey, KeyLength);
+   memcpy(Input + KeyLength, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID) - 1);
+
+   uint8_t Digest[21];
+   Sha1(Input, KeyLength + sizeof(WEBSOCKET_GUID) - 1, Digest);
+   Digest[20] = 0;
+
+   //20 bytes are 6 full groups of 3 and one group of 2, padded with a single '='
+   char *p = szAccept;
+   for (uint8_t i = 0; i < 21; i += 3)
+   {
+      uint32_t Group = ((uint32_t)Digest[i] << 16) | ((uint32_t)Digest[i + 1] << 8) | Digest[i + 2];
+      *p++ = Base64[(Group >> 18) & 0x3F];
+      *p++ = Base64[(Group >> 12) & 0x3F];
+      *p++ = Base64[(Group >> 6) & 0x3F];
+      *p++ = i + 3 <= 20 ? Base64[Group & 0x3F] : '=';
+   }
+   *p = '\0';
+}
@@ -0,0 +1,362 @@
+/*
+WifiNumericDisplay - A numeric 4-digit display which can be controlled over WiFi
+Copyright (C) 2018  Alex Goris
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Push-only WebSocket server (RFC 6455) for browsers that mirror the display. Broadcast() sends a text message to every
+//open connection, messages from the browser are read and thrown away, except for a close.
+//Every Loop() does a bounded amount of work: at most one new connection and WEBSOCKET_READ_BUDGET bytes per connection.
+//A connection whose send buffer is full misses a message instead of stalling the loop, the next one catches it up.
+
+#ifndef _WebSocketPush_h
+#define _WebSocketPush_h
+
+#include <Arduino.h>
+#include <Log.h>
+
+#define WEBSOCKET_SLOTS 2
+#define WEBSOCKET_MAX_MESSAGE 125  //Longest message, fits the 7 bit payload length
+#define WEBSOCKET_LINE_SIZE 64     //Handshake header lines are read into this, longer lines are skipped
+#define WEBSOCKET_READ_BUDGET 64   //Bytes read per connection per Loop()
+#define WEBSOCKET_HANDSHAKE_TIMEOUT 5000
+#define WEBSOCKET_KEY_LENGTH 24    //Base64 of a 16 byte nonce
+#define WEBSOCKET_ACCEPT_LENGTH 28 //Base64 of a SHA-1 hash
+
+//Writes the Sec-WebSocket-Accept value for szKey to szAccept, which must hold WEBSOCKET_ACCEPT_LENGTH + 1 characters
+void WebSocketAcceptKey(const char *szKey, char *szAccept);
+
+struct WebSocketPushStats
+{
+   unsigned long ulConnects;
+   unsigned long ulRefused;  //No free slot, or not a WebSocket handshake
+   unsigned long ulMessages; //Messages sent, counted per connection
+   unsigned long ulSkipped;  //Messages a connection missed because its send buffer was full
+};
+
+template <class Transport, uint8_t Slots = WEBSOCKET_SLOTS>
+class WebSocketPush
+{
+public:
+   void init(typename Transport::Server *Server) { _Server = Server; }
+   void Loop();
+   //Sends szMessage to every open connection, new connections get the last message as soon as they open
+   void Broadcast(const char *szMessage);
+
+   uint8_t GetConnectionCount() const;
+   const WebSocketPushStats &GetStats() const { return _Stats; }
+
+private:
+   enum _SlotState : uint8_t
+   {
+      SLOT_FREE,
+      SLOT_HANDSHAKE,
+      SLOT_OPEN,
+   };
+
+   struct _Connection
+   {
+      _SlotState State = SLOT_FREE;
+      typename Transport::Client ClientObj;
+      unsigned long ulOpenTime = 0;
+      //Handshake
+      char szLine[WEBSOCKET_LINE_SIZE];
+      uint8_t iLineLength = 0;
+      bool bLineTooLong = false;
+      char szKey[WEBSOCKET_KEY_LENGTH + 1];
+      //Incoming frames, only the header is kept
+      uint8_t Header[14];
+      uint8_t iHeaderLength = 0;
+      uint64_t ullPayloadLeft = 0;
+   };
+
+   typename Transport::Server *_Server = NULL;
+   _Connection _Connections[Slots];
+   char _szLastMessage[WEBSOCKET_MAX_MESSAGE + 1] = "";
+   WebSocketPushStats _Stats = {};
+
+   void _Accept();
+   void _ReadHandshake(_Connection &Connection);
+   //Returns false if the request is not a WebSocket handshake
+   bool _HandleHeaderLine(_Connection &Connection);
+   void _ReadFrames(_Connection &Connection);
+   void _Send(_Connection &Connection, uint8_t Opcode, const char *Data, size_t Length);
+   void _Close(_Connection &Connection);
+};
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::Loop()
+{
+   if (_Server == NULL)
+   {
+      return;
+   }
+   _Accept();
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      auto &Connection = _Connections[i];
+      if (Connection.State == SLOT_FREE)
+      {
+         continue;
+      }
+      if (!Connection.ClientObj.connected())
+      {
+         _Close(Connection);
+         continue;
+      }
+      if (Connection.State == SLOT_HANDSHAKE)
+      {
+         _ReadHandshake(Connection);
+      }
+      else
+      {
+         _ReadFrames(Connection);
+      }
+   }
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::Broadcast(const char *szMessage)
+{
+   strncpy(_szLastMessage, szMessage, WEBSOCKET_MAX_MESSAGE);
+   _szLastMessage[WEBSOCKET_MAX_MESSAGE] = '\0';
+   size_t Length = strlen(_szLastMessage);
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      if (_Connections[i].State == SLOT_OPEN)
+      {
+         _Send(_Connections[i], 0x1, _szLastMessage, Length);
+      }
+   }
+}
+
+template <class Transport, uint8_t Slots>
+uint8_t WebSocketPush<Transport, Slots>::GetConnectionCount() const
+{
+   uint8_t iCount = 0;
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      iCount += _Connections[i].State == SLOT_OPEN;
+   }
+   return iCount;
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::_Accept()
+{
+   auto ClientObj = _Server->available();
+   if (!ClientObj.connected())
+   {
+      return;
+   }
+   for (uint8_t i = 0; i < Slots; i++)
+   {
+      auto &Connection = _Connections[i];
+      if (Connection.State == SLOT_FREE)
+      {
+         Connection.ClientObj = ClientObj;
+         Connection.ClientObj.setNoDelay(true);
+         Connection.State = SLOT_HANDSHAKE;
+         Connection.ulOpenTime = millis();
+         Connection.iLineLength = 0;
+         Connection.bLineTooLong = false;
+         Connection.szKey[0] = '\0';
+         Connection.iHeaderLength = 0;
+         Connection.ullPayloadLeft = 0;
+         return;
+      }
+   }
+   LOG_WARN("All WebSocket slots taken, refusing connection\r\n");
+   _Stats.ulRefused++;
+   ClientObj.stop();
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::_ReadHandshake(_Connection &Connection)
+{
+   if (millis() - Connection.ulOpenTime > WEBSOCKET_HANDSHAKE_TIMEOUT)
+   {
+      LOG_WARN("WebSocket handshake timed out\r\n");
+      _Stats.ulRefused++;
+      _Close(Connection);
+      return;
+   }
+
+   uint8_t Chunk[WEBSOCKET_READ_BUDGET];
+   int iRead = Connection.ClientObj.available() > 0 ? Connection.ClientObj.read(Chunk, sizeof(Chunk)) : 0;
+   for (int i = 0; i < iRead; i++)
+   {
+      char c = Chunk[i];
+      if (c == '\r')
+      {
+         continue;
+      }
+      if (c != '\n')
+      {
+         if (Connection.iLineLength < WEBSOCKET_LINE_SIZE - 1)
+         {
+            Connection.szLine[Connection.iLineLength++] = c;
+         }
+         else
+         {
+            Connection.bLineTooLong = true;
+         }
+         continue;
+      }
+
+      Connection.szLine[Connection.iLineLength] = '\0';
+      if (!_HandleHeaderLine(Connection))
+      {
+         _Stats.ulRefused++;
+         _Close(Connection);
+         return;
+      }
+      if (Connection.State == SLOT_OPEN)
+      {
+         //Anything after the handshake is a frame from the browser
+         Connection.iLineLength = 0;
+         return;
+      }
+      Connection.iLineLength = 0;
+      Connection.bLineTooLong = false;
+   }
+}
+
+template <class Transport, uint8_t Slots>
+bool WebSocketPush<Transport, Slots>::_HandleHeaderLine(_Connection &Connection)
+{
+   static const char KeyHeader[] = "Sec-WebSocket-Key:";
+   if (Connection.iLineLength > 0)
+   {
+      //Only the key matters, other headers (and long ones like cookies) are skipped
+      if (!Connection.bLineTooLong && strncasecmp(Connection.szLine, KeyHeader, sizeof(KeyHeader) - 1) == 0)
+      {
+         const char *szValue = Connection.szLine + sizeof(KeyHeader) - 1;
+         while (*szValue == ' ')
+         {
+            szValue++;
+         }
+         if (strlen(szValue) != WEBSOCKET_KEY_LENGTH)
+         {
+            return false;
+         }
+         strcpy(Connection.szKey, szValue);
+      }
+      return true;
+   }
+
+   //Blank line, end of the request
+   if (Connection.szKey[0] == '\0')
+   {
+      static const char BadRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+      Connection.ClientObj.write((const uint8_t *)BadRequest, sizeof(BadRequest) - 1);
+      return false;
+   }
+   char szAccept[WEBSOCKET_ACCEPT_LENGTH + 1];
+   WebSocketAcceptKey(Connection.szKey, szAccept);
+   char szResponse[160];
+   int iLength = snprintf(szResponse, sizeof(szResponse),
+                          "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n",
+                          szAccept);
+   Connection.ClientObj.write((const uint8_t *)szResponse, iLength);
+   Connection.State = SLOT_OPEN;
+   _Stats.ulConnects++;
+   LOG_INFO("WebSocket client connected\r\n");
+   if (_szLastMessage[0] != '\0')
+   {
+      _Send(Connection, 0x1, _szLastMessage, strlen(_szLastMessage));
+   }
+   return true;
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::_ReadFrames(_Connection &Connection)
+{
+   uint8_t Chunk[WEBSOCKET_READ_BUDGET];
+   int iRead = Connection.ClientObj.available() > 0 ? Connection.ClientObj.read(Chunk, sizeof(Chunk)) : 0;
+   for (int i = 0; i < iRead; i++)
+   {
+      if (Connection.ullPayloadLeft > 0)
+      {
+         Connection.ullPayloadLeft--;
+         continue;
+      }
+
+      Connection.Header[Connection.iHeaderLength++] = Chunk[i];
+      if (Connection.iHeaderLength < 2)
+      {
+         continue;
+      }
+      //Browser frames are always masked, the 4 byte mask follows the (extended) length
+      uint8_t iLengthCode = Connection.Header[1] & 0x7F;
+      uint8_t iHeaderSize = 2 + (iLengthCode == 126 ? 2 : iLengthCode == 127 ? 8 : 0) + ((Connection.Header[1] & 0x80) ? 4 : 0);
+      if (Connection.iHeaderLength < iHeaderSize)
+      {
+         continue;
+      }
+
+      uint64_t ullLength = iLengthCode;
+      if (iLengthCode >= 126)
+      {
+         ullLength = 0;
+         for (uint8_t j = 2; j < (iLengthCode == 126 ? 4 : 10); j++)
+         {
+            ullLength = (ullLength << 8) | Connection.Header[j];
+         }
+      }
+      Connection.iHeaderLength = 0;
+      Connection.ullPayloadLeft = ullLength;
+      if ((Connection.Header[0] & 0x0F) == 0x8)
+      {
+         //Close, answer it and drop the connection
+         _Send(Connection, 0x8, NULL, 0);
+         LOG_INFO("WebSocket client disconnected\r\n");
+         _Close(Connection);
+         return;
+      }
+   }
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::_Send(_Connection &Connection, uint8_t Opcode, const char *Data, size_t Length)
+{
+   uint8_t Frame[2 + WEBSOCKET_MAX_MESSAGE];
+   if (Length > WEBSOCKET_MAX_MESSAGE)
+   {
+      Length = WEBSOCKET_MAX_MESSAGE;
+   }
+   if ((size_t)Connection.ClientObj.availableForWrite() < Length + 2)
+   {
+      _Stats.ulSkipped++;
+      return;
+   }
+   Frame[0] = 0x80 | Opcode; //Final fragment
+   Frame[1] = Length;
+   if (Length > 0)
+   {
+      memcpy(Frame + 2, Data, Length);
+   }
+   Connection.ClientObj.write(Frame, Length + 2);
+   _Stats.ulMessages++;
+}
+
+template <class Transport, uint8_t Slots>
+void WebSocketPush<Transport, Slots>::_Close(_Connection &Connection)
+{
+   Connection.ClientObj.stop();
+   Connection.State = SLOT_FREE;
+}
+
+#endif
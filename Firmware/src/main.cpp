@@ -22,22 +22,37 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <DNSServer.h>
 #include <ESP8266WebServer.h>
 #include <NetworkServer.h>
+#include <UdpListener.h>
+#include <WiFiTransport.h>
 #include <ESP8266WiFi.h>
 #include <ESP8266mDNS.h>
 #include <ArduinoOTA.h>
 #include <math.h>
 #include <ArduinoJson.h>
+#include <Log.h>
+#include <DisplayDriver.h>
+#include <CommandParser.h>
+#include <Stopwatch.h>
+#include <ClockSync.h>
+#include <TaskScheduler.h>
+#include <Metrics.h>
+#include <BinaryFrame.h>
+#include <SegmentFont.h>
+#include <WebSocketPush.h>
+#include <DisplayState.h>
+#include <ConfigStore.h>
+#include <SerialSource.h>
 
 /**************************** Wifi Configuration ****************************/
 String strHostname;
 wl_status_t PrevWifiState;
 WiFiManager wifiMan;
 
-//static IP params
-//default custom static IP
-char static_ip[16] = "";
-char static_gw[16] = "";
-char static_sn[16] = "";
+//Static IP, host name, display group and last display state, see ConfigStore.h
+#define DISPLAY_GROUP_DEFAULT 1
+#define CONFIG_JSON_SIZE 512 //Largest /config.json that is migrated
+DisplayConfig Config;
+ConfigStore Store;
 
 //flag for saving data
 bool shouldSaveConfig = false;
@@ -51,93 +66,496 @@ bool shouldSaveConfig = false;
 byte segmentClock = D2;
 byte segmentLatch = D3;
 byte segmentData = D1;
-#define NUM_DIGITS 4
+DisplayDriver Display;
 
 //Configure server which listens for incoming messages
 WiFiServer ServerPort23(23);
-NetworkServer MessageServer;
-
-//Serial comms stuff
-bool bInputStringComplete = false;
-String strInputData;
+NetworkServer<WiFiTransport> MessageServer;
+QueuedMessage CurrentMessage;
+
+//With COALESCE_NUMBERS set, a number is skipped when a newer number is already waiting behind it,
+//so the display catches up at once after a network stall. Control messages are never skipped.
+#ifndef COALESCE_NUMBERS
+#define COALESCE_NUMBERS 0
+#endif
+unsigned long ulDroppedNumberUpdates = 0;
+
+//Optional UDP listener, updates a whole group of displays with one packet. UDP_PORT 0 leaves it out,
+//with UDP_MULTICAST_ADDRESS set (e.g. "239.0.0.23") it joins that multicast group instead of only taking broadcasts.
+#ifndef UDP_PORT
+#define UDP_PORT 23
+#endif
+#if UDP_PORT
+UdpListener<WiFiTransport> UpdateListener;
+#endif
+
+//Status page and control API over HTTP on HTTP_PORT, changes of the display are pushed to browsers with a WebSocket
+//on WEBSOCKET_PORT. A port set to 0 leaves that part out.
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+#ifndef WEBSOCKET_PORT
+#define WEBSOCKET_PORT 81
+#endif
+#define HTTP_CHUNK_SIZE 160         //Streamed responses are formatted in pieces of at most this size
+#define WEBSOCKET_PUSH_INTERVAL 50 //ms, the display is pushed at most this often, the last change always gets out
+#if HTTP_PORT
+ESP8266WebServer HttpServer(HTTP_PORT);
+#endif
+#if WEBSOCKET_PORT
+WiFiServer WebSocketPort(WEBSOCKET_PORT);
+WebSocketPush<WiFiTransport> DisplayPush;
+unsigned long ulPushedLatchCount = 0;
+#endif
+
+//Commands on the serial port, queued with the network messages (see MessageQueue.h)
+SerialSource SerialCommands;
 
 //Countdown timer variables
 int iCountDownTimer = 0;
 int iCountDownCurrentValue = 0;
 unsigned long ulCountDownStartTime = 0;
 
+//Stopwatch, shown as SS.ss and counted on the display itself so a run needs no network traffic
+Stopwatch RunTimer;
+long lStopwatchShownValue = -1; //-1 forces the next time to be shown
+uint8_t iStopwatchShownDecimals = 0;
+
+//Clock sync with the host and the command scheduled with AT, if any
+#define SCHEDULE_MAX_AHEAD 60000000 //us, AT times further ahead are rejected as a clock mixup
+ClockSync HostClock;
+bool bCommandScheduled = false;
+uint32_t ulScheduledMicros = 0;
+bool bScheduledPreloaded = false; //Number or CLR, already shifted into the chain
+char szScheduledCommand[MESSAGE_MAX_LENGTH];
+
+//Timer driven jobs, loop() only runs the ones which are due
+TaskScheduler Tasks;
+uint8_t iScheduledTask = TASK_INVALID;
+uint8_t iCountDownTask = TASK_INVALID;
+uint8_t iStopwatchTask = TASK_INVALID;
+uint8_t iActivityLEDTask = TASK_INVALID;
+uint8_t iBootTask = TASK_INVALID;
+
+//Boot doesn't wait for WiFi: setup() puts the state from before the reset back on the display and starts the servers,
+//then loop() runs (serial commands work) while HandleBoot() waits for the stored network to connect.
+//Boot phase times are kept for the boot log line and STATS.
+#define WIFI_CONNECT_TIMEOUT 30000 //ms to wait for the stored network before the blocking config portal starts
+#define BOOT_POLL_INTERVAL 50
+#define DISPLAY_STATE_SAVE_INTERVAL 100 //ms between checks whether the shown state changed, see DisplayState.h
+bool bBootDone = false;
+bool bStateRestored = false;
+uint32_t ulBootRestoredMicros = 0; //Restored state latched
+uint32_t ulBootSetupMicros = 0;    //setup() done, loop() starts
+unsigned long ulBootWifiMillis = 0; //Connected and ready for OTA
+DisplayState SavedState;
+
+//The last display state is also kept in the config, for a power up (RTC memory is lost then). It is only written once
+//it stayed the same for DISPLAY_STATE_PERSIST_STABLE and at most once every DISPLAY_STATE_PERSIST_MIN_INTERVAL: every
+//write erases the flash sector and stalls the CPU for tens of ms, a running countdown would wear it out otherwise.
+#define DISPLAY_STATE_PERSIST_INTERVAL 1000
+#define DISPLAY_STATE_PERSIST_STABLE 10000
+#define DISPLAY_STATE_PERSIST_MIN_INTERVAL 60000
+unsigned long ulStateChangeMillis = 0;
+unsigned long ulStatePersistMillis = 0;
+bool bStatePersisted = false;
+
+//With IDLE_SLEEP_MAX set (ms), loop() delay()s until the next task when there was nothing to do, so the CPU idles
+//and WiFi modem-sleep can save power. Messages then wait up to that long before they are handled.
+#ifndef IDLE_SLEEP_MAX
+#define IDLE_SLEEP_MAX 0
+#endif
+
+//Runtime metrics for the STATS command, see Metrics.h
+#if METRICS_ENABLED
+#define METRICS_HEAP_INTERVAL 1000 //ms between free heap samples for the low water mark
+#define STATS_REPLY_SIZE 256
+DurationHistogram LoopTimes;
+DurationHistogram LatchLatency; //Message arrival to latch, for messages that changed the display
+unsigned long ulWifiStateChanges = 0;
+uint32_t ulMinFreeHeap = UINT32_MAX;
+#endif
+
 //Alive ping timer
 #define ALIVE_PING_INTERVAL 5000
-unsigned long ulLastAlivePing = 0;
-unsigned long ulLastLEDOnTime = 0;
-byte bLEDState = HIGH;
-byte bPrevledState = HIGH;
+#define WIFI_STATE_INTERVAL 250
+#define CLIENT_STATE_LOG_INTERVAL 500
 
 //Reset NW button pin
 #define RESET_NW_PIN D8
 #define RESET_NW_PRESS_TIME 3000 //Time to press reset button before NW settings will be cleared
+#define RESET_NW_POLL_INTERVAL 50
 unsigned long ulButtonDepressTime = 0;
 
 //Activity LED
 #define ACTIVITY_LED_PIN LED_BUILTIN
+#define ACTIVITY_LED_ON_TIME 100
 unsigned long ulLEDLinkInterval = 1000; //every second
-unsigned long ulLEDOnTime = 0;
+byte bLEDState = HIGH;
 
 void ResetNetwork();
 void HandleNWResetButton();
 void HandleActivityLED();
+void HandleWifiState();
+void HandleBoot();
+#if UDP_PORT
+//Display group from the config, see UdpListener.h
+uint8_t GetDisplayGroup()
+{
+   if (Config.iGroup == 0)
+   {
+      LOG_WARN("Invalid display group 0, using %u\r\n", DISPLAY_GROUP_DEFAULT);
+      return DISPLAY_GROUP_DEFAULT;
+   }
+   return Config.iGroup;
+}
+#endif
+#if METRICS_ENABLED
+void SampleFreeHeap()
+{
+   uint32_t ulFreeHeap = ESP.getFreeHeap();
+   if (ulFreeHeap < ulMinFreeHeap)
+   {
+      ulMinFreeHeap = ulFreeHeap;
+   }
+}
+#endif
+
+//snprintf() behind the first Length characters of Buffer, returns the new length. Text that doesn't fit is cut off.
+size_t AppendFormat(char *Buffer, size_t Size, size_t Length, const char *Format, ...)
+{
+   if (Length + 1 >= Size)
+   {
+      return Length;
+   }
+   va_list Args;
+   va_start(Args, Format);
+   int iWritten = vsnprintf(Buffer + Length, Size - Length, Format, Args);
+   va_end(Args);
+   if (iWritten < 0)
+   {
+      return Length;
+   }
+   return Length + iWritten < Size ? Length + iWritten : Size - 1;
+}
+
+//Answers STATS with a single line, over TCP to the client that asked or on the serial port:
+//STATS up:<s> boot:<restored us>,<setup us>,<wifi ms> loop:<n>,<p50>,<p99>,<max> latency:<n>,<p50>,<p99>,<max> heap:<free>,<largest block>,<lowest free>
+//wifi:<state changes> net:<connects>,<refused>,<evictions>,<timeouts>,<overflows> udp:<accepted>,<stale>,<other group>,<invalid>
+//slots:<messages>/<bytes>,... with all durations in us, percentiles are the upper end of their histogram bucket
+bool SendStats(const QueuedMessage *Source)
+{
+#if METRICS_ENABLED
+   if (Source != NULL && Source->iSource == UDP_MESSAGE_SOURCE)
+   {
+      LOG_WARN("STATS needs a TCP connection or the serial port\r\n");
+      return false;
+   }
+
+   char szStats[STATS_REPLY_SIZE];
+   const NetworkServerStats &NetStats = MessageServer.GetStats();
+   size_t Length = AppendFormat(szStats, sizeof(szStats) - 1, 0,
+                                "STATS up:%lu boot:%lu,%lu,%lu loop:%lu,%lu,%lu,%lu latency:%lu,%lu,%lu,%lu heap:%lu,%lu,%lu wifi:%lu net:%lu,%lu,%lu,%lu,%lu",
+                                millis() / 1000, (unsigned long)ulBootRestoredMicros, (unsigned long)ulBootSetupMicros, ulBootWifiMillis,
+                                (unsigned long)LoopTimes.GetCount(), (unsigned long)LoopTimes.GetPercentile(50),
+                                (unsigned long)LoopTimes.GetPercentile(99), (unsigned long)LoopTimes.GetMax(),
+                                (unsigned long)LatchLatency.GetCount(), (unsigned long)LatchLatency.GetPercentile(50),
+                                (unsigned long)LatchLatency.GetPercentile(99), (unsigned long)LatchLatency.GetMax(),
+                                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxFreeBlockSize(), (unsigned long)ulMinFreeHeap,
+                                ulWifiStateChanges, NetStats.ulConnects, NetStats.ulRefused, NetStats.ulEvictions, NetStats.ulTimeouts,
+                                NetStats.ulOverflows);
+#if UDP_PORT
+   const UdpListenerStats &UdpStats = UpdateListener.GetStats();
+   Length = AppendFormat(szStats, sizeof(szStats) - 1, Length, " udp:%lu,%lu,%lu,%lu", UdpStats.ulAccepted, UdpStats.ulStale,
+                         UdpStats.ulOtherGroup, UdpStats.ulInvalid);
+#endif
+   for (uint8_t i = 0; i < NETWORK_CLIENT_SLOTS; i++)
+   {
+      const NetworkSlotStats &SlotStats = MessageServer.GetSlotStats(i);
+      Length = AppendFormat(szStats, sizeof(szStats) - 1, Length, "%s%lu/%lu", i == 0 ? " slots:" : ",", SlotStats.ulMessages,
+                            SlotStats.ulBytes);
+   }
+   //One byte was kept free for the newline
+   szStats[Length++] = '\n';
+
+   if (Source == NULL || Source->iSource == SERIAL_MESSAGE_SOURCE)
+   {
+      Log.WriteRaw(szStats, Length);
+   }
+   else
+   {
+      MessageServer.Send(*Source, (const uint8_t *)szStats, Length);
+   }
+   return true;
+#else
+   LOG_WARN("STATS is not available, built with METRICS_ENABLED=0\r\n");
+   return false;
+#endif
+}
+
+void HandleAlivePing();
+void SampleFreeHeap();
+bool SendStats(const QueuedMessage *Source);
+size_t AppendFormat(char *Buffer, size_t Size, size_t Length, const char *Format, ...);
+void LoadConfig();
+bool MigrateJsonConfig();
 void HandleWifiConfig();
+void OnWifiConnected();
+bool RestoreDisplayState();
+void SaveDisplayState();
+void PersistDisplayState();
 void StopCountDownTimer();
 void StartCountDownTimer(unsigned int iSeconds);
+void PrepareCountDownTimer(unsigned int iSeconds);
 void HandleCountDownTimer();
-void serialEvent();
-void postNumber(byte number, boolean decimal);
+void StartStopwatch(unsigned long ulOffsetHundredths);
+void HandleStopwatch();
+void ShowStopwatchTime(unsigned long ulHundredths);
+void StopTimers();
+bool ScheduleCommand(unsigned long ulHostTime, const char *szCommand);
+void HandleScheduledCommand();
+void SendTimeSyncAnswer(const QueuedMessage &Message, unsigned long ulHostSend);
 void ShowNumber(long lValue, uint8_t iNumDecimals);
 void ClearDisplay();
 void saveConfigCallback();
+bool HandleMessage(const QueuedMessage &Message);
+bool HandleCommand(const char *szCommand, const QueuedMessage *Source = NULL);
+bool HandleBinaryFrame(const uint8_t *Body, uint8_t Length);
+bool IsNumberUpdate(const QueuedMessage &Message);
+
+//Writes the shown digits as text to szText, e.g. " 1.23", read back from the segments so anything shown can be mirrored.
+//Segment patterns that aren't a character come out as '?'.
+size_t FormatDisplayText(char *szText, size_t Size)
+{
+   const uint8_t *Frame = Display.GetFrame();
+   size_t Length = 0;
+   for (uint8_t i = 0; i < DISPLAY_NUM_DIGITS && Length + 2 < Size; i++)
+   {
+      uint8_t Canonical = DisplayWiring::Unmap(Frame[i]);
+      szText[Length++] = GlyphCharacter(Canonical & ~SEG_DP);
+      if (Canonical & SEG_DP)
+      {
+         szText[Length++] = '.';
+      }
+   }
+   szText[Length] = '\0';
+   return Length;
+}
+
+//{"display":" 1.23","segments":[0,134,91,79]} with the segments as SegmentFont bits, pushed over the WebSocket and
+//part of the status document
+size_t FormatDisplayJson(char *szJson, size_t Size)
+{
+   char szText[2 * DISPLAY_NUM_DIGITS + 1];
+   FormatDisplayText(szText, sizeof(szText));
+   size_t Length = AppendFormat(szJson, Size, 0, "{\"display\":\"%s\",\"segments\":[", szText);
+   const uint8_t *Frame = Display.GetFrame();
+   for (uint8_t i = 0; i < DISPLAY_NUM_DIGITS; i++)
+   {
+      Length = AppendFormat(szJson, Size, Length, i == 0 ? "%u" : ",%u", DisplayWiring::Unmap(Frame[i]));
+   }
+   return AppendFormat(szJson, Size, Length, "]}");
+}
+
+#if HTTP_PORT
+//Formats the next piece of a streamed response, so a document of any size only needs HTTP_CHUNK_SIZE of stack
+void SendHttpChunk(const char *Format, ...)
+{
+   char szChunk[HTTP_CHUNK_SIZE];
+   va_list Args;
+   va_start(Args, Format);
+   int iLength = vsnprintf(szChunk, sizeof(szChunk), Format, Args);
+   va_end(Args);
+   if (iLength > 0)
+   {
+      HttpServer.sendContent(szChunk, (size_t)iLength < sizeof(szChunk) ? iLength : sizeof(szChunk) - 1);
+   }
+}
+
+//GET /status, the whole state of the display as one JSON document:
+//{"uptime":<s>,"boot":{"restored_us":<n>,"setup_us":<n>,"wifi_ms":<n>},"shown":{<see FormatDisplayJson>},
+//"mode":"static|countdown|stopwatch","countdown":<s left>,
+//"stopwatch":{"running":<bool>,"hundredths":<n>},"scheduled":<bool>,"clock_synced":<bool>,"group":<n>,
+//"clients":[{"slot":<n>,"connected":<bool>,"sequenced":<bool>,"idle":<ms>,"messages":<n>,"bytes":<n>},...],
+//"websockets":<n>,"metrics":{...}} with metrics like STATS reports them, left out when built without them
+void HandleHttpStatus()
+{
+   char szShown[WEBSOCKET_MAX_MESSAGE + 1];
+   FormatDisplayJson(szShown, sizeof(szShown));
+   const char *szMode = iCountDownTimer > 0 ? "countdown" : RunTimer.IsRunning() ? "stopwatch" : "static";
+
+   HttpServer.sendHeader("Access-Control-Allow-Origin", "*");
+   HttpServer.sendHeader("Cache-Control", "no-store");
+   HttpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+   HttpServer.send(200, "application/json", "");
+   SendHttpChunk("{\"uptime\":%lu,\"boot\":{\"restored_us\":%lu,\"setup_us\":%lu,\"wifi_ms\":%lu},", millis() / 1000,
+                 (unsigned long)ulBootRestoredMicros, (unsigned long)ulBootSetupMicros, ulBootWifiMillis);
+   SendHttpChunk("\"shown\":%s,\"mode\":\"%s\",\"countdown\":%i,", szShown, szMode, iCountDownCurrentValue);
+   SendHttpChunk("\"stopwatch\":{\"running\":%s,\"hundredths\":%lu},\"scheduled\":%s,\"clock_synced\":%s,\"group\":%u,\"clients\":[",
+                 RunTimer.IsRunning() ? "true" : "false", RunTimer.GetHundredths(), bCommandScheduled ? "true" : "false",
+                 HostClock.IsSynced() ? "true" : "false", Config.iGroup);
+   for (uint8_t i = 0; i < NETWORK_CLIENT_SLOTS; i++)
+   {
+      NetworkSlotInfo Info = MessageServer.GetSlotInfo(i);
+#if METRICS_ENABLED
+      const NetworkSlotStats &SlotStats = MessageServer.GetSlotStats(i);
+#else
+      const NetworkSlotStats SlotStats = {};
+#endif
+      SendHttpChunk("%s{\"slot\":%u,\"connected\":%s,\"sequenced\":%s,\"idle\":%lu,\"messages\":%lu,\"bytes\":%lu}", i == 0 ? "" : ",",
+                    i, Info.bConnected ? "true" : "false", Info.bSequenced ? "true" : "false", Info.ulIdleMillis, SlotStats.ulMessages,
+                    SlotStats.ulBytes);
+   }
+#if WEBSOCKET_PORT
+   SendHttpChunk("],\"websockets\":%u", DisplayPush.GetConnectionCount());
+#else
+   SendHttpChunk("],\"websockets\":0");
+#endif
+#if METRICS_ENABLED
+   const char szHistogram[] = "{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}";
+   SendHttpChunk("%s", ",\"metrics\":{\"loop\":");
+   SendHttpChunk(szHistogram, (unsigned long)LoopTimes.GetCount(), (unsigned long)LoopTimes.GetPercentile(50),
+                 (unsigned long)LoopTimes.GetPercentile(99), (unsigned long)LoopTimes.GetMax());
+   SendHttpChunk("%s", ",\"latency\":");
+   SendHttpChunk(szHistogram, (unsigned long)LatchLatency.GetCount(), (unsigned long)LatchLatency.GetPercentile(50),
+                 (unsigned long)LatchLatency.GetPercentile(99), (unsigned long)LatchLatency.GetMax());
+   const NetworkServerStats &NetStats = MessageServer.GetStats();
+   SendHttpChunk(",\"heap\":{\"free\":%lu,\"largest_block\":%lu,\"lowest_free\":%lu},\"wifi_changes\":%lu,", (unsigned long)ESP.getFreeHeap(),
+                 (unsigned long)ESP.getMaxFreeBlockSize(), (unsigned long)ulMinFreeHeap, ulWifiStateChanges);
+   SendHttpChunk("\"net\":{\"connects\":%lu,\"refused\":%lu,\"evictions\":%lu,\"timeouts\":%lu,\"overflows\":%lu}", NetStats.ulConnects,
+                 NetStats.ulRefused, NetStats.ulEvictions, NetStats.ulTimeouts, NetStats.ulOverflows);
+#if UDP_PORT
+   const UdpListenerStats &UdpStats = UpdateListener.GetStats();
+   SendHttpChunk(",\"udp\":{\"accepted\":%lu,\"stale\":%lu,\"other_group\":%lu,\"invalid\":%lu}", UdpStats.ulAccepted, UdpStats.ulStale,
+                 UdpStats.ulOtherGroup, UdpStats.ulInvalid);
+#endif
+   SendHttpChunk("%s", "}");
+#endif
+   SendHttpChunk("%s", "}\n");
+   HttpServer.sendContent("", 0); //Ends the chunked response
+}
+
+//GET or POST /command?cmd=<message>, handles a message just like one received on port 23 and answers
+//{"accepted":true} or {"accepted":false} with status 400. TS and STATS are refused, their answer has no way back.
+void HandleHttpCommand()
+{
+   String strCommand = HttpServer.arg("cmd");
+   ParsedCommand Command;
+   bool bAccepted = strCommand.length() > 0 && strCommand.length() < MESSAGE_MAX_LENGTH && ParseCommand(strCommand.c_str(), Command) &&
+                    Command.Type != COMMAND_TIME_SYNC && Command.Type != COMMAND_STATS && HandleCommand(strCommand.c_str());
+   HttpServer.send(bAccepted ? 200 : 400, "application/json", bAccepted ? "{\"accepted\":true}\n" : "{\"accepted\":false}\n");
+}
+
+#if WEBSOCKET_PORT
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+//GET /, a page which mirrors the display through the WebSocket, for a tablet next to the ring
+static const char MirrorPage[] PROGMEM =
+    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width\"><title>Display</title></head>"
+    "<body style=\"background:#000;color:#f22;font:22vw monospace;text-align:center;white-space:pre;margin:0\">"
+    "<div id=\"d\">----</div><script>function c(){var w=new WebSocket('ws://'+location.hostname+':" TO_STRING(WEBSOCKET_PORT) "/');"
+    "w.onmessage=function(e){document.getElementById('d').textContent=JSON.parse(e.data).display};"
+    "w.onclose=function(){setTimeout(c,1000)}}c()</script></body></html>";
+#endif
+#endif
+
+#if WEBSOCKET_PORT
+//Pushes the display to the WebSocket clients if it changed since the last push, runs every WEBSOCKET_PUSH_INTERVAL
+//so a fast update stream is thinned out instead of flooding slow browsers
+void PushDisplayChange()
+{
+   if (Display.GetLatchCount() == ulPushedLatchCount)
+   {
+      return;
+   }
+   ulPushedLatchCount = Display.GetLatchCount();
+   char szMessage[WEBSOCKET_MAX_MESSAGE + 1];
+   FormatDisplayJson(szMessage, sizeof(szMessage));
+   DisplayPush.Broadcast(szMessage);
+}
+#endif
 
 void setup()
 {
    Serial.begin(74880);
    Serial.println();
-   String realSize = String(ESP.getFlashChipRealSize());
-   String ideSize = String(ESP.getFlashChipSize());
-   bool flashCorrectlyConfigured = realSize.equals(ideSize);
-   if (flashCorrectlyConfigured)
-      SPIFFS.begin();
-   else
-      Serial.println("flash incorrectly configured, SPIFFS cannot start, IDE size: " + ideSize + ", real size: " + realSize);
-
-   Serial.println("Starting setup...");
+   LOG_INFO("Starting setup...\r\n");
    //configure IO pins
    pinMode(RESET_NW_PIN, INPUT);
    pinMode(ACTIVITY_LED_PIN, OUTPUT);
 
-   pinMode(segmentClock, OUTPUT);
-   pinMode(segmentData, OUTPUT);
-   pinMode(segmentLatch, OUTPUT);
-
-   digitalWrite(segmentClock, LOW);
-   digitalWrite(segmentData, LOW);
-   digitalWrite(segmentLatch, LOW);
-
-   //Clear display
-   ClearDisplay();
-
-   //Handle config
-   Serial.printf("Starting wifi config\r\n");
-   HandleWifiConfig();
+   Display.init(segmentData, segmentClock, segmentLatch);
+
+   //Timers without a period are started by the command that needs them, they are added first so a restored
+   //countdown or stopwatch can start them
+   iScheduledTask = Tasks.Add("scheduled", HandleScheduledCommand);
+   iCountDownTask = Tasks.Add("countdown", HandleCountDownTimer);
+   iStopwatchTask = Tasks.Add("stopwatch", HandleStopwatch);
+   iActivityLEDTask = Tasks.Add("led", HandleActivityLED);
+   Tasks.RunIn(iActivityLEDTask, 0);
+   iBootTask = Tasks.Add("boot", HandleBoot);
+   Tasks.RunIn(iBootTask, 0);
+   Tasks.Add("state", SaveDisplayState, DISPLAY_STATE_SAVE_INTERVAL * 1000UL);
+   Tasks.Add("persist", PersistDisplayState, DISPLAY_STATE_PERSIST_INTERVAL * 1000UL);
+   Tasks.Add("button", HandleNWResetButton, RESET_NW_POLL_INTERVAL * 1000UL);
+   Tasks.Add("wifi", HandleWifiState, WIFI_STATE_INTERVAL * 1000UL);
+   Tasks.Add("alive", HandleAlivePing, ALIVE_PING_INTERVAL * 1000UL);
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+   Tasks.Add("clients", []() { MessageServer.LogClientStates(); }, CLIENT_STATE_LOG_INTERVAL * 1000UL);
+#endif
+#if WEBSOCKET_PORT
+   Tasks.Add("push", PushDisplayChange, WEBSOCKET_PUSH_INTERVAL * 1000UL);
+#endif
+#if METRICS_ENABLED
+   Tasks.Add("heap", SampleFreeHeap, METRICS_HEAP_INTERVAL * 1000UL);
+#endif
+
+   //Show what was shown before the reset, or clear the display if nothing was saved
+   LoadConfig();
+   bStateRestored = RestoreDisplayState();
+   if (!bStateRestored)
+   {
+      ClearDisplay();
+   }
+   ulBootRestoredMicros = micros();
 
-   strHostname = WiFi.hostname();
-   String strLocalIp = WiFi.localIP().toString();
-   uint iLastIpPart = strLocalIp.substring(strLocalIp.lastIndexOf('.') + 1).toInt();
-   ShowNumber(iLastIpPart, 0);
-   Serial.printf("Connected to AP %s, IP: %s, name: %s\r\n", WiFi.SSID().c_str(), strLocalIp.c_str(), strHostname.c_str());
+   //Connect to the stored network in the background, HandleBoot() starts the config portal if that doesn't work
+   WiFi.mode(WIFI_STA);
+   if (Config.szHostname[0] != '\0')
+   {
+      WiFi.hostname(Config.szHostname);
+   }
+   IPAddress StaticIp, StaticGateway, StaticSubnet;
+   if (StaticIp.fromString(Config.szStaticIp) && StaticGateway.fromString(Config.szGateway) && StaticSubnet.fromString(Config.szSubnet))
+   {
+      WiFi.config(StaticIp, StaticGateway, StaticSubnet);
+   }
+   WiFi.begin();
+#if IDLE_SLEEP_MAX
+   WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+#endif
 
+   //Servers listen on every interface, so they can start before the network is up. HTTP and WebSocket wait for
+   //OnWifiConnected(), the config portal may need port 80 first.
    ServerPort23.begin();
    MessageServer.init(&ServerPort23);
-
-   //OTA Firmware update stuff
+   SerialCommands.init(&Serial, &MessageServer.GetQueue());
+#if UDP_PORT && !defined(UDP_MULTICAST_ADDRESS)
+   UpdateListener.begin(UDP_PORT, GetDisplayGroup());
+#endif
+#if HTTP_PORT
+   HttpServer.on("/status", HTTP_GET, HandleHttpStatus);
+   HttpServer.on("/command", HandleHttpCommand);
+#if WEBSOCKET_PORT
+   HttpServer.on("/", HTTP_GET, []() { HttpServer.send_P(200, "text/html", MirrorPage); });
+#endif
+   HttpServer.onNotFound([]() { HttpServer.send(404, "application/json", "{\"error\":\"not found\"}\n"); });
+#endif
+#if WEBSOCKET_PORT
+   DisplayPush.init(&WebSocketPort);
+#endif
+
+   //OTA Firmware update stuff, started once WiFi is connected
    // Port defaults to 8266
    ArduinoOTA.setPort(8266);
 
@@ -148,247 +566,356 @@ void setup()
    ArduinoOTA.setPassword((const char *)OTA_PASSWD);
 
    ArduinoOTA.onStart([]() {
-      Serial.printf("Receiving new OTA firmware...\r\n");
+      LOG_INFO("Receiving new OTA firmware...\r\n");
+      Log.Flush();
    });
    ArduinoOTA.onEnd([]() {
-      Serial.printf("New firwmare received, rebooting!\r\n");
+      LOG_INFO("New firwmare received, rebooting!\r\n");
+      Log.Flush();
    });
    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-      Serial.printf("OTA Progress: %u%%\r", (progress / (total / 100)));
+      LOG_DEBUG("OTA Progress: %u%%\r", (progress / (total / 100)));
    });
    ArduinoOTA.onError([](ota_error_t error) {
-      Serial.printf("OTA Error: %u", error);
+      LOG_ERROR("OTA Error: %u\r\n", error);
    });
-   ArduinoOTA.begin();
 
-   Serial.printf("Starting!");
+   ulBootSetupMicros = micros();
+   LOG_INFO("Starting!\r\n");
 }
 
 void loop()
 {
-   while (millis() < 3000)
-   {
-      //Don't do anything first 3 seconds so system can settle down a bit
-      return;
-   }
+#if METRICS_ENABLED
+   uint32_t ulLoopStart = micros();
+#endif
 
-   //Call main loops
-   serialEvent();
+   //Call main loops, timers first so a scheduled latch doesn't wait for the network
+   Tasks.Loop();
+   SerialCommands.Loop();
    MessageServer.Loop();
-   HandleCountDownTimer();
-   HandleActivityLED();
-   HandleNWResetButton();
-   ArduinoOTA.handle();
-   if (MessageServer.Available())
+   if (bBootDone)
    {
-      strInputData = MessageServer.GetOldestData();
-      bInputStringComplete = true;
+#if HTTP_PORT
+      HttpServer.handleClient();
+#endif
+#if WEBSOCKET_PORT
+      DisplayPush.Loop();
+#endif
+      ArduinoOTA.handle();
    }
+   Log.Loop();
 
-   //Check wifi status
-   wl_status_t WifiState = WiFi.status();
-   if (WifiState != PrevWifiState)
+   //Handle every message received from the network or serial port, in order of arrival. Only TCP clients get replies,
+   //MessageServer ignores messages of the other input sources.
+   bool bIdle = true;
+   while (MessageServer.GetMessage(CurrentMessage))
    {
-      Serial.printf("Wifi state changed to: %s!\r\n", (WifiState != WL_CONNECTED ? "Connection lost" : "Connected"));
-      if (WifiState == WL_CONNECTED)
+      bIdle = false;
+#if COALESCE_NUMBERS
+      auto NextMessage = MessageServer.PeekMessage();
+      if (NextMessage != NULL && IsNumberUpdate(CurrentMessage) && IsNumberUpdate(*NextMessage))
       {
-         //Show (potentially new) IP on display
-         String strLocalIp = WiFi.localIP().toString();
-         uint iLastIpPart = strLocalIp.substring(strLocalIp.lastIndexOf('.') + 1).toInt();
-         ShowNumber(iLastIpPart, 0);
+         ulDroppedNumberUpdates++;
+         LOG_DEBUG("Skipping %s, newer number pending\r\n", CurrentMessage.szData);
+         MessageServer.Reply(CurrentMessage, true);
+         continue;
       }
-      PrevWifiState = WifiState;
+#endif
+      MessageServer.Reply(CurrentMessage, HandleMessage(CurrentMessage));
    }
 
-   if (bInputStringComplete)
+#if UDP_PORT
+   //UDP messages are handled the same way, but never answered
+   while (UpdateListener.GetMessage(CurrentMessage))
    {
-      Serial.printf("Received data: %s\r\n", strInputData.c_str());
+      bIdle = false;
+      HandleMessage(CurrentMessage);
+   }
+#endif
 
-      if (strInputData.indexOf("CD") > -1)
-      {
-         //We should start a coundown timer
-         unsigned int iRequestedCountDownTime = strInputData.substring(2).toInt();
-         StartCountDownTimer(iRequestedCountDownTime);
-         Serial.printf("Starting countdown for %i seconds...\r\n", iRequestedCountDownTime);
-      }
-      else if (strInputData == "CLR")
-      {
-         ClearDisplay();
-         Serial.printf("Clearing display...\r\n");
-      }
-      else if (strInputData == "RSTNW")
-      {
-         //Reset network
-         ResetNetwork();
-      }
-      else if (strInputData.toInt() >= -999 && strInputData.toInt() <= 9999)
+   METRICS_RECORD(LoopTimes, (uint32_t)micros() - ulLoopStart);
+
+#if IDLE_SLEEP_MAX > 0
+   if (bIdle)
+   {
+      //Nothing to do until the next task, delay() lets the CPU idle and the modem sleep
+      uint32_t ulIdleMillis = Tasks.GetMicrosToNextTask() / 1000;
+      if (ulIdleMillis > 0)
       {
-         StopCountDownTimer();
-         ShowNumber(strInputData.toInt(), 2);
-         Serial.printf("Showing number: %li ...\r\n", strInputData.toInt());
+         delay(ulIdleMillis < IDLE_SLEEP_MAX ? ulIdleMillis : IDLE_SLEEP_MAX);
+         return;
       }
-      else
+   }
+#else
+   (void)bIdle;
+#endif
+   yield(); //Allow background stuff to happen
+}
+
+//Waits for the stored network in the background and finishes the boot once it is connected. Without a stored network,
+//or when it can't be reached within WIFI_CONNECT_TIMEOUT, the config portal runs, which blocks until it is done.
+void HandleBoot()
+{
+   if (WiFi.status() != WL_CONNECTED)
+   {
+      if (millis() < WIFI_CONNECT_TIMEOUT && WiFi.SSID().length() > 0)
       {
-         //Invalid data received, make logging
-         Serial.printf("Invalid data received, don't know what to do with this: %s\r\n", strInputData.c_str());
+         Tasks.RunIn(iBootTask, BOOT_POLL_INTERVAL * 1000UL);
+         return;
       }
-
-      //Reset input data for next loop
-      bInputStringComplete = false;
-      strInputData = "";
+      LOG_WARN("Could not connect to the stored network, starting wifi config\r\n");
+      HandleWifiConfig();
    }
+   OnWifiConnected();
+}
 
-   if (millis() - ulLastAlivePing > ALIVE_PING_INTERVAL)
+//Last part of the boot, everything that needs the network to be up
+void OnWifiConnected()
+{
+   strHostname = WiFi.hostname();
+   String strLocalIp = WiFi.localIP().toString();
+   LOG_INFO("Connected to AP %s, IP: %s, name: %s\r\n", WiFi.SSID().c_str(), strLocalIp.c_str(), strHostname.c_str());
+   if (!bStateRestored)
    {
-      Serial.printf("Alive for %li seconds!\r\n", millis() / 1000);
-      ulLastAlivePing = millis();
+      //Nothing to show yet, show the last part of the IP like after every reconnect
+      uint iLastIpPart = strLocalIp.substring(strLocalIp.lastIndexOf('.') + 1).toInt();
+      ShowNumber(iLastIpPart, 0);
    }
+   PrevWifiState = WL_CONNECTED;
+
+#if UDP_PORT && defined(UDP_MULTICAST_ADDRESS)
+   //Joining the group needs the interface address
+   IPAddress MulticastAddress;
+   MulticastAddress.fromString(UDP_MULTICAST_ADDRESS);
+   UpdateListener.beginMulticast(WiFi.localIP(), MulticastAddress, UDP_PORT, GetDisplayGroup());
+#endif
+   //The config portal runs its own web server on port 80, ours can only listen once it is done
+#if HTTP_PORT
+   HttpServer.begin();
+#endif
+#if WEBSOCKET_PORT
+   WebSocketPort.begin();
+#endif
+   ArduinoOTA.begin();
 
-   yield(); //Allow background stuff to happen
+   bBootDone = true;
+   ulBootWifiMillis = millis();
+   LOG_INFO("Boot: display restored after %lu us, setup done after %lu us, WiFi connected after %lu ms\r\n",
+            (unsigned long)ulBootRestoredMicros, (unsigned long)ulBootSetupMicros, ulBootWifiMillis);
 }
 
-//Clears display so all segments of all digits are OFF
-void ClearDisplay()
+void HandleWifiState()
 {
-   for (byte x = 0; x < NUM_DIGITS; x++)
+   if (!bBootDone)
    {
-      postNumber(' ', false);
+      //HandleBoot() reports the first connection
+      return;
+   }
+   wl_status_t WifiState = WiFi.status();
+   if (WifiState != PrevWifiState)
+   {
+      LOG_INFO("Wifi state changed to: %s!\r\n", (WifiState != WL_CONNECTED ? "Connection lost" : "Connected"));
+      METRICS_COUNT(ulWifiStateChanges);
+      if (WifiState == WL_CONNECTED)
+      {
+         //Show (potentially new) IP on display
+         String strLocalIp = WiFi.localIP().toString();
+         uint iLastIpPart = strLocalIp.substring(strLocalIp.lastIndexOf('.') + 1).toInt();
+         ShowNumber(iLastIpPart, 0);
+      }
+      PrevWifiState = WifiState;
    }
-   //Latch the current segment data
-   digitalWrite(segmentLatch, LOW);
-   digitalWrite(segmentLatch, HIGH);
-   return;
 }
 
-//Displays a number.
-void ShowNumber(long lValue, uint8_t iNumDecimals)
+void HandleAlivePing()
 {
-   byte x = 0;
-   bool bNegative = false;
-   int8_t iNumDigitsModifier = 0;
+   LOG_INFO("Alive for %lu seconds!\r\n", millis() / 1000);
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+   Tasks.LogStats();
+#endif
+}
 
-   Serial.printf("Got number %lu\r\n", lValue);
+//Returns true for a plain text number, the only kind of message coalescing may skip
+bool IsNumberUpdate(const QueuedMessage &Message)
+{
+   ParsedCommand Command;
+   return Message.Type == MESSAGE_TEXT && ParseCommand(Message.szData, Command) && Command.Type == COMMAND_NUMBER;
+}
 
-   if (lValue < 0)
+//Handles a message from the network or serial port, returns false if it is invalid
+bool HandleMessage(const QueuedMessage &Message)
+{
+#if METRICS_ENABLED
+   unsigned long ulLatchCount = Display.GetLatchCount();
+#endif
+   bool bValid;
+   if (Message.Type == MESSAGE_BINARY)
    {
-      //negative value, remember for later (first digit should be sent last)
-      bNegative = true;
-      iNumDigitsModifier = -1;
-      lValue = abs(lValue);
+      bValid = HandleBinaryFrame((const uint8_t *)Message.szData, Message.iLength);
    }
-   while (x < (NUM_DIGITS + iNumDigitsModifier))
+   else
    {
-      int remainder = lValue % 10;
-      if (remainder == 0 && lValue == 0 && (x > iNumDecimals))
-      {
-         //Don't display prefix zeroes
-         remainder = ' ';
-      }
-      Serial.printf("Calling PostNumber with data: %i (lVal: %li, x: %i)\r\n", remainder, lValue, x);
-      postNumber(remainder, (x == iNumDecimals && iNumDecimals > 0));
-
-      lValue /= 10;
-      x++;
+      bValid = HandleCommand(Message.szData, &Message);
    }
-   if (bNegative)
+#if METRICS_ENABLED
+   if (Display.GetLatchCount() != ulLatchCount)
    {
-      //Send negative symbol last (=first digit)
-      postNumber('-', false);
+      LatchLatency.Record((uint32_t)micros() - (uint32_t)Message.ulArrivalMicros);
    }
-
-   //Latch the current segment data
-   digitalWrite(segmentLatch, LOW);
-   digitalWrite(segmentLatch, HIGH); //Register moves storage register on the rising edge of RCK
+#endif
+   return bValid;
 }
 
-//Given a number, or '-', shifts it out to the display
-void postNumber(byte number, boolean decimal)
+//Applies all ops of a binary frame and shows the result with a single latch.
+//Every op is checked first, so a frame with a bad op changes nothing.
+bool HandleBinaryFrame(const uint8_t *Body, uint8_t Length)
 {
-   //    -  A
-   //   / / F/B
-   //    -  G
-   //   / / E/C
-   //    -. D/DP
+   if (!ValidateBinaryOps(Body, Length))
+   {
+      LOG_WARN("Invalid binary frame received\r\n");
+      return false;
+   }
 
-#define a 1 << 0
-#define b 1 << 6
-#define c 1 << 5
-#define d 1 << 4
-#define e 1 << 3
-#define f 1 << 1
-#define g 1 << 2
-#define dp 1 << 7
+   BinaryOpReader Reader(Body, Length);
+   BinaryOp Op;
+   while (Reader.Next(Op))
+   {
+      switch (Op.Opcode)
+      {
+      case BINARY_OP_SET_NUMBER:
+         StopTimers();
+         Display.SetNumber(Op.lValue, Op.iDecimals);
+         break;
 
-   byte segments = 0;
+      case BINARY_OP_COUNTDOWN:
+         PrepareCountDownTimer(Op.lValue);
+         break;
 
-   switch (number)
+      case BINARY_OP_CLEAR:
+         StopTimers();
+         Display.Clear();
+         break;
+
+      case BINARY_OP_SEGMENTS:
+         StopTimers();
+         for (uint8_t i = 0; i < Op.iCount; i++)
+         {
+            Display.SetSegments(Op.iPosition + i, DisplayWiring::Map(Op.Segments[i]));
+         }
+         break;
+      }
+   }
+   Display.Commit();
+   return true;
+}
+
+//Handles a single command received from the network or serial port, returns false if it isn't a valid command.
+//Source is the message the command came in, answers that carry data are sent back to it.
+bool HandleCommand(const char *szCommand, const QueuedMessage *Source)
+{
+   LOG_DEBUG("Received data: %s\r\n", szCommand);
+
+   ParsedCommand Command;
+   ParseCommand(szCommand, Command);
+   switch (Command.Type)
    {
-   case 1:
-      segments = b | c;
+   case COMMAND_COUNTDOWN:
+      //We should start a coundown timer
+      StartCountDownTimer(Command.lValue);
+      LOG_INFO("Starting countdown for %li seconds...\r\n", Command.lValue);
       break;
-   case 2:
-      segments = a | b | d | e | g;
-      break;
-   case 3:
-      segments = a | b | c | d | g;
-      break;
-   case 4:
-      segments = f | g | b | c;
-      break;
-   case 5:
-      segments = a | f | g | c | d;
-      break;
-   case 6:
-      segments = a | f | g | e | c | d;
-      break;
-   case 7:
-      segments = a | b | c;
+
+   case COMMAND_CLEAR:
+      StopTimers();
+      ClearDisplay();
+      LOG_INFO("Clearing display...\r\n");
       break;
-   case 8:
-      segments = a | b | c | d | e | f | g;
+
+   case COMMAND_RESET_NETWORK:
+      //Anyone on the network can send a UDP packet, wiping the WiFi settings needs a connection or the serial port
+      if (Source != NULL && Source->iSource == UDP_MESSAGE_SOURCE)
+      {
+         LOG_WARN("Network reset is not accepted over UDP\r\n");
+         return false;
+      }
+      //Reset network
+      ResetNetwork();
       break;
-   case 9:
-      segments = a | b | c | d | f | g;
+
+   case COMMAND_STOPWATCH_START:
+      StartStopwatch(Command.lValue);
+      LOG_INFO("Starting stopwatch at %li hundredths...\r\n", Command.lValue);
       break;
-   case 0:
-      segments = a | b | c | d | e | f;
+
+   case COMMAND_STOPWATCH_STOP:
+      if (RunTimer.IsRunning())
+      {
+         RunTimer.Stop();
+         ShowStopwatchTime(RunTimer.GetHundredths());
+         LOG_INFO("Stopwatch stopped at %lu hundredths\r\n", RunTimer.GetHundredths());
+      }
       break;
-   case ' ':
-      segments = 0;
+
+   case COMMAND_STOPWATCH_FINAL:
+      StopCountDownTimer();
+      RunTimer.Finish(Command.lValue);
+      lStopwatchShownValue = -1;
+      ShowStopwatchTime(RunTimer.GetHundredths());
+      LOG_INFO("Stopwatch final time %li hundredths\r\n", Command.lValue);
       break;
-   case 'c':
-      segments = g | e | d;
+
+   case COMMAND_TIME_SYNC:
+      if (Source == NULL || Source->iSource == UDP_MESSAGE_SOURCE || Source->iSource == SERIAL_MESSAGE_SOURCE)
+      {
+         LOG_WARN("Clock sync needs a TCP connection\r\n");
+         return false;
+      }
+      SendTimeSyncAnswer(*Source, Command.ulTime);
       break;
-   case '-':
-      segments = g;
+
+   case COMMAND_TIME_SYNC_RESULT:
+      if (!HostClock.Complete(Command.ulTime, Command.ulTime2))
+      {
+         LOG_WARN("Clock sync result without matching request: %s\r\n", szCommand);
+         return false;
+      }
+      LOG_DEBUG("Clock offset %li us, round trip %lu us\r\n", (long)HostClock.GetOffset(), (unsigned long)HostClock.GetRoundTrip());
       break;
-   }
 
-   if (decimal)
-      segments |= dp;
+   case COMMAND_SCHEDULED:
+      return ScheduleCommand(Command.ulTime, Command.szScheduled);
+
+   case COMMAND_STATS:
+      return SendStats(Source);
 
-   Serial.printf("Writing data to SR: %i\r\n", segments);
+   case COMMAND_NUMBER:
+      StopTimers();
+      ShowNumber(Command.lValue, 2);
+      LOG_DEBUG("Showing number: %li ...\r\n", Command.lValue);
+      break;
 
-   digitalWrite(segmentClock, LOW);
-   shiftOut(segmentData, segmentClock, MSBFIRST, segments);
+   default:
+      //Invalid data received, make logging
+      LOG_WARN("Invalid data received, don't know what to do with this: %s\r\n", szCommand);
+      return false;
+   }
+   return true;
 }
 
-void serialEvent()
+//Clears display so all segments of all digits are OFF
+void ClearDisplay()
 {
-   //Listen on serial port
-   Serial.flush();
-   while (Serial.available() > 0)
-   {
-      char cInChar = Serial.read(); // Read a character
-      if (cInChar == '\n')          //Check if buffer contains complete serial message, terminated by newline (\n)
-      {
-         //Serial message in buffer is complete, null terminate it and store it for further handling
-         bInputStringComplete = true;
-         //strInputData += '\0'; // Null terminate the string
-         break;
-      }
-      strInputData += cInChar; // Store it
-   }
+   Display.Clear();
+   Display.Commit();
+}
+
+//Displays a number, the display is only updated if the shown digits change
+void ShowNumber(long lValue, uint8_t iNumDecimals)
+{
+   LOG_DEBUG("Got number %li\r\n", lValue);
+   Display.SetNumber(lValue, iNumDecimals);
+   Display.Commit();
 }
 
 void HandleCountDownTimer()
@@ -399,8 +926,13 @@ void HandleCountDownTimer()
       return;
    }
 
-   //How far are we?
-   unsigned int iTimeExpired = (millis() - ulCountDownStartTime) / 1000;
+   //How far are we? A task that ran very late must not count past zero
+   unsigned long ulElapsed = millis() - ulCountDownStartTime;
+   unsigned int iTimeExpired = ulElapsed / 1000;
+   if (iTimeExpired > (unsigned int)iCountDownTimer)
+   {
+      iTimeExpired = iCountDownTimer;
+   }
    if ((int)(iCountDownTimer - iTimeExpired) != iCountDownCurrentValue)
    {
       ShowNumber(iCountDownTimer - iTimeExpired, 0);
@@ -409,18 +941,27 @@ void HandleCountDownTimer()
    if (iCountDownCurrentValue == 0)
    {
       StopCountDownTimer();
+      return;
    }
-   return;
+   //Run again when the next second starts
+   Tasks.RunIn(iCountDownTask, (1000 - ulElapsed % 1000) * 1000UL);
 }
 
 void StartCountDownTimer(unsigned int iSeconds)
 {
+   PrepareCountDownTimer(iSeconds);
+   Display.Commit();
+}
+
+//Starts the countdown with its first number in the frame, the caller commits it
+void PrepareCountDownTimer(unsigned int iSeconds)
+{
+   RunTimer.Reset();
    ulCountDownStartTime = millis();
    iCountDownTimer = iSeconds;
    iCountDownCurrentValue = iSeconds;
-   //Make sure first number of countdown is shown
-   ShowNumber(iCountDownTimer, 0);
-   return;
+   Display.SetNumber(iCountDownTimer, 0);
+   Tasks.RunIn(iCountDownTask, 1000000UL);
 }
 
 void StopCountDownTimer()
@@ -428,79 +969,331 @@ void StopCountDownTimer()
    ulCountDownStartTime = 0;
    iCountDownTimer = 0;
    iCountDownCurrentValue = 0;
-   return;
+   Tasks.Stop(iCountDownTask);
 }
 
-void HandleWifiConfig()
+void StartStopwatch(unsigned long ulOffsetHundredths)
+{
+   StopCountDownTimer();
+   RunTimer.Start(ulOffsetHundredths);
+   lStopwatchShownValue = -1;
+   ShowStopwatchTime(RunTimer.GetHundredths());
+   Tasks.RunIn(iStopwatchTask, RunTimer.GetMicrosToNextHundredth());
+}
+
+void HandleStopwatch()
+{
+   if (!RunTimer.IsRunning())
+   {
+      return;
+   }
+   ShowStopwatchTime(RunTimer.Update());
+   Tasks.RunIn(iStopwatchTask, RunTimer.GetMicrosToNextHundredth());
+}
+
+//Shows SS.ss, or SSS.s and SSSS once the time no longer fits. Nothing is done until the shown digits change.
+void ShowStopwatchTime(unsigned long ulHundredths)
 {
-   //read configuration from FS json
-   Serial.println("mounting FS...");
+   long lValue = ulHundredths;
+   uint8_t iDecimals = 2;
+   if (ulHundredths >= 1000000)
+   {
+      lValue = 9999;
+      iDecimals = 0;
+   }
+   else if (ulHundredths >= 100000)
+   {
+      lValue = ulHundredths / 100;
+      iDecimals = 0;
+   }
+   else if (ulHundredths >= 10000)
+   {
+      lValue = ulHundredths / 10;
+      iDecimals = 1;
+   }
 
-   if (SPIFFS.begin())
+   if (lValue == lStopwatchShownValue && iDecimals == iStopwatchShownDecimals)
    {
-      Serial.println("mounted file system");
-      if (SPIFFS.exists("/config.json"))
+      return;
+   }
+   lStopwatchShownValue = lValue;
+   iStopwatchShownDecimals = iDecimals;
+   ShowNumber(lValue, iDecimals);
+}
+
+//Answers TS<t1> with T<t1>,<t2>,<t3>, see ClockSync.h
+void SendTimeSyncAnswer(const QueuedMessage &Message, unsigned long ulHostSend)
+{
+   char szAnswer[40];
+   uint32_t ulDisplaySend = micros();
+   int iLength = snprintf(szAnswer, sizeof(szAnswer), "T%lu,%lu,%lu\n", ulHostSend, (unsigned long)(uint32_t)Message.ulArrivalMicros,
+                          (unsigned long)ulDisplaySend);
+   HostClock.Request(ulHostSend, Message.ulArrivalMicros, ulDisplaySend);
+   MessageServer.Send(Message, (const uint8_t *)szAnswer, iLength);
+}
+
+//Runs szCommand when the synced clock reaches host time ulHostTime. Numbers and CLR are shifted into the chain
+//right away, so only the latch pulse is left at that time. A new AT replaces one that is still waiting.
+bool ScheduleCommand(unsigned long ulHostTime, const char *szCommand)
+{
+   if (!HostClock.IsSynced())
+   {
+      LOG_WARN("Can't schedule %s, clock not synced\r\n", szCommand);
+      return false;
+   }
+   uint32_t ulLocalTime = HostClock.ToLocal(ulHostTime);
+   if ((int32_t)(ulLocalTime - (uint32_t)micros()) > SCHEDULE_MAX_AHEAD)
+   {
+      LOG_WARN("Can't schedule %s, %lu is too far ahead\r\n", szCommand, ulHostTime);
+      return false;
+   }
+
+   ParsedCommand Command;
+   ParseCommand(szCommand, Command);
+   strncpy(szScheduledCommand, szCommand, sizeof(szScheduledCommand) - 1);
+   szScheduledCommand[sizeof(szScheduledCommand) - 1] = '\0';
+   ulScheduledMicros = ulLocalTime;
+   bCommandScheduled = true;
+   Tasks.RunAt(iScheduledTask, ulScheduledMicros);
+   bScheduledPreloaded = Command.Type == COMMAND_NUMBER || Command.Type == COMMAND_CLEAR;
+   if (bScheduledPreloaded)
+   {
+      DisplayDriver Frame;
+      Frame.Clear();
+      if (Command.Type == COMMAND_NUMBER)
       {
-         //file exists, reading and loading
-         Serial.println("reading config file");
-         File configFile = SPIFFS.open("/config.json", "r");
-         if (configFile)
-         {
-            Serial.println("opened config file");
-            size_t size = configFile.size();
-            // Allocate a buffer to store contents of the file.
-            std::unique_ptr<char[]> buf(new char[size]);
-
-            configFile.readBytes(buf.get(), size);
-            DynamicJsonBuffer jsonBuffer;
-            JsonObject &json = jsonBuffer.parseObject(buf.get());
-            json.printTo(Serial);
-            if (json.success())
-            {
-               Serial.println("\nparsed json");
-
-               if (json["ip"])
-               {
-                  Serial.println("setting custom ip from config");
-                  //static_ip = json["ip"];
-                  strcpy(static_ip, json["ip"]);
-                  strcpy(static_gw, json["gateway"]);
-                  strcpy(static_sn, json["subnet"]);
-                  //strcat(static_ip, json["ip"]);
-                  //static_gw = json["gateway"];
-                  //static_sn = json["subnet"];
-                  Serial.println(static_ip);
-                  /*            Serial.println("converting ip");
-                  IPAddress ip = ipFromCharArray(static_ip);
-                  Serial.println(ip);*/
-               }
-               else
-               {
-                  Serial.println("no custom ip in config");
-               }
-            }
-            else
-            {
-               Serial.println("failed to load json config");
-            }
-         }
+         Frame.SetNumber(Command.lValue, 2);
       }
+      Display.Preload(Frame.GetFrame());
+   }
+   LOG_DEBUG("Scheduled %s at %lu us\r\n", szScheduledCommand, (unsigned long)ulScheduledMicros);
+
+   //A time in the past is run at once
+   HandleScheduledCommand();
+   return true;
+}
+
+void HandleScheduledCommand()
+{
+   if (!bCommandScheduled || (int32_t)((uint32_t)micros() - ulScheduledMicros) < 0)
+   {
+      return;
+   }
+   bCommandScheduled = false;
+   Tasks.Stop(iScheduledTask);
+   if (bScheduledPreloaded)
+   {
+      StopTimers();
+      Display.LatchPreloaded();
    }
    else
    {
-      Serial.println("failed to mount FS, formatting...");
-      SPIFFS.format();
-      ESP.reset();
+      HandleCommand(szScheduledCommand);
    }
+}
 
+//Stops whichever timer is running, so it doesn't overwrite what is shown next
+void StopTimers()
+{
+   StopCountDownTimer();
+   RunTimer.Reset();
+   Tasks.Stop(iStopwatchTask);
+}
+
+//What is shown now, with a running countdown or stopwatch as its current value
+void CaptureDisplayState(DisplayState &State)
+{
+   memset(&State, 0, sizeof(State)); //Padding included, states are compared with memcmp()
+   const uint8_t *Frame = Display.GetFrame();
+   for (uint8_t i = 0; i < DISPLAY_NUM_DIGITS; i++)
+   {
+      State.Segments[i] = DisplayWiring::Unmap(Frame[i]);
+   }
+   if (iCountDownTimer > 0)
+   {
+      State.Mode = DISPLAY_STATE_COUNTDOWN;
+      State.ulValue = iCountDownCurrentValue;
+   }
+   else if (RunTimer.IsRunning())
+   {
+      State.Mode = DISPLAY_STATE_STOPWATCH;
+      State.bRunning = true;
+      State.ulValue = RunTimer.GetHundredths();
+   }
+   else
+   {
+      State.Mode = DISPLAY_STATE_STATIC;
+   }
+}
+
+//Keeps RTC memory up to date with what is shown, runs every DISPLAY_STATE_SAVE_INTERVAL
+void SaveDisplayState()
+{
+   DisplayState State;
+   CaptureDisplayState(State);
+   if (memcmp(&State, &SavedState, sizeof(State)) != 0)
+   {
+      SaveRtcDisplayState(State);
+      SavedState = State;
+      ulStateChangeMillis = millis();
+   }
+}
+
+//Copies the display state to the config once it stopped changing, see DISPLAY_STATE_PERSIST_STABLE
+void PersistDisplayState()
+{
+   if (millis() - ulStateChangeMillis < DISPLAY_STATE_PERSIST_STABLE ||
+       (bStatePersisted && millis() - ulStatePersistMillis < DISPLAY_STATE_PERSIST_MIN_INTERVAL))
+   {
+      return;
+   }
+   if (Config.bLastStateValid && memcmp(&Config.LastState, &SavedState, sizeof(SavedState)) == 0)
+   {
+      return;
+   }
+   Config.LastState = SavedState;
+   Config.bLastStateValid = true;
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+   uint32_t ulStart = micros();
+#endif
+   if (Store.Save(Config))
+   {
+      LOG_DEBUG("Display state saved to the config in %lu us\r\n", (unsigned long)(micros() - ulStart));
+   }
+   else
+   {
+      LOG_WARN("Could not save the display state to the config\r\n");
+   }
+   bStatePersisted = true;
+   ulStatePersistMillis = millis();
+}
+
+//Shows the state saved before the last reset, or after a power up the one last persisted to the config. Returns false
+//if there is none. A countdown or stopwatch continues from its last saved value, the time the display was down is not known.
+bool RestoreDisplayState()
+{
+   DisplayState State;
+   if (!LoadRtcDisplayState(State))
+   {
+      if (!Config.bLastStateValid)
+      {
+         LOG_INFO("No display state to restore\r\n");
+         return false;
+      }
+      State = Config.LastState;
+   }
+   if (State.Mode == DISPLAY_STATE_COUNTDOWN && State.ulValue > 0)
+   {
+      StartCountDownTimer(State.ulValue);
+   }
+   else if (State.Mode == DISPLAY_STATE_STOPWATCH && State.bRunning)
+   {
+      StartStopwatch(State.ulValue);
+   }
+   else
+   {
+      for (uint8_t i = 0; i < DISPLAY_NUM_DIGITS; i++)
+      {
+         Display.SetSegments(i, DisplayWiring::Map(State.Segments[i]));
+      }
+      Display.Commit();
+   }
+   LOG_INFO("Restored display state, mode %u value %lu\r\n", State.Mode, (unsigned long)State.ulValue);
+   return true;
+}
+
+//Loads the config record, on the first boot with a ConfigStore it is migrated from /config.json
+void LoadConfig()
+{
+   memset(&Config, 0, sizeof(Config));
+   Config.iGroup = DISPLAY_GROUP_DEFAULT;
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+   uint32_t ulStart = micros();
+#endif
+   if (Store.Load(Config))
+   {
+      LOG_INFO("Config loaded in %lu us\r\n", (unsigned long)(micros() - ulStart));
+      return;
+   }
+   LOG_INFO("No stored config\r\n");
+   if (MigrateJsonConfig())
+   {
+      Store.Save(Config);
+   }
+}
+
+//Reads the static IP and display group from a /config.json written by older firmware, and renames it so this only
+//happens once. Returns false if there was nothing to migrate.
+bool MigrateJsonConfig()
+{
+   String realSize = String(ESP.getFlashChipRealSize());
+   String ideSize = String(ESP.getFlashChipSize());
+   if (!realSize.equals(ideSize))
+   {
+      LOG_ERROR("flash incorrectly configured, SPIFFS cannot start, IDE size: %s, real size: %s\r\n", ideSize.c_str(), realSize.c_str());
+      return false;
+   }
+   if (!SPIFFS.begin())
+   {
+      LOG_WARN("failed to mount FS, nothing to migrate\r\n");
+      return false;
+   }
+   File configFile = SPIFFS.open("/config.json", "r");
+   if (!configFile)
+   {
+      SPIFFS.end();
+      return false;
+   }
+   char szJson[CONFIG_JSON_SIZE];
+   size_t Length = configFile.readBytes(szJson, sizeof(szJson) - 1);
+   szJson[Length] = '\0';
+   configFile.close();
+
+   DynamicJsonBuffer jsonBuffer;
+   JsonObject &json = jsonBuffer.parseObject(szJson);
+   bool bMigrated = json.success();
+   if (bMigrated)
+   {
+      if (json["ip"])
+      {
+         CopyConfigString(Config.szStaticIp, sizeof(Config.szStaticIp), json["ip"]);
+         CopyConfigString(Config.szGateway, sizeof(Config.szGateway), json["gateway"]);
+         CopyConfigString(Config.szSubnet, sizeof(Config.szSubnet), json["subnet"]);
+      }
+      if (json["group"])
+      {
+         long lGroup = atol(json["group"]);
+         Config.iGroup = lGroup >= 1 && lGroup <= 255 ? lGroup : DISPLAY_GROUP_DEFAULT;
+      }
+      SPIFFS.rename("/config.json", "/config.json.migrated");
+      LOG_INFO("Migrated /config.json, ip %s group %u\r\n", Config.szStaticIp, Config.iGroup);
+   }
+   else
+   {
+      LOG_WARN("failed to parse /config.json, not migrated\r\n");
+   }
+   SPIFFS.end();
+   return bMigrated;
+}
+
+//Runs WiFiManager, which connects to the stored network or starts the config portal and blocks until it is done
+void HandleWifiConfig()
+{
    //set config save notify callback
    wifiMan.setSaveConfigCallback(saveConfigCallback);
 
+   char szGroup[4];
+   snprintf(szGroup, sizeof(szGroup), "%u", Config.iGroup);
+   WiFiManagerParameter custom_group("group", "display group (1-255)", szGroup, sizeof(szGroup) - 1);
+   wifiMan.addParameter(&custom_group);
+   WiFiManagerParameter custom_hostname("hostname", "host name", Config.szHostname, sizeof(Config.szHostname) - 1);
+   wifiMan.addParameter(&custom_hostname);
+
    //set static ip
    IPAddress _ip, _gw, _sn;
-   _ip.fromString(static_ip);
-   _gw.fromString(static_gw);
-   _sn.fromString(static_sn);
+   _ip.fromString(Config.szStaticIp);
+   _gw.fromString(Config.szGateway);
+   _sn.fromString(Config.szSubnet);
 
    wifiMan.setSTAStaticIPConfig(_ip, _gw, _sn);
 
@@ -513,71 +1306,53 @@ void HandleWifiConfig()
    //and goes into a blocking loop awaiting configuration
    char ssid[20];
    snprintf(ssid, 20, "EJS-DSP-%08X", ESP.getChipId());
-   Serial.printf("Starting access point with ssid %s\r\n", ssid);
+   LOG_INFO("Starting access point with ssid %s\r\n", ssid);
+   Log.Flush();
    if (!wifiMan.autoConnect(ssid))
    {
-      Serial.println("failed to connect and hit timeout");
+      LOG_ERROR("failed to connect and hit timeout\r\n");
+      Log.Flush();
       delay(3000);
       //reset and try again, or maybe put it to deep sleep
       ESP.reset();
    }
 
    //if you get here you have connected to the WiFi
-   Serial.println("connected...yeey :)");
+   LOG_INFO("connected...yeey :)\r\n");
 
-   //save the custom parameters to FS
+   //save the custom parameters to the config
    if (shouldSaveConfig)
    {
-      Serial.println("saving config");
-      DynamicJsonBuffer jsonBuffer;
-      JsonObject &json = jsonBuffer.createObject();
-
-      json["ip"] = WiFi.localIP().toString();
-      json["gateway"] = WiFi.gatewayIP().toString();
-      json["subnet"] = WiFi.subnetMask().toString();
-
-      File configFile = SPIFFS.open("/config.json", "w");
-      if (!configFile)
+      LOG_INFO("saving config\r\n");
+      CopyConfigString(Config.szStaticIp, sizeof(Config.szStaticIp), WiFi.localIP().toString().c_str());
+      CopyConfigString(Config.szGateway, sizeof(Config.szGateway), WiFi.gatewayIP().toString().c_str());
+      CopyConfigString(Config.szSubnet, sizeof(Config.szSubnet), WiFi.subnetMask().toString().c_str());
+      CopyConfigString(Config.szHostname, sizeof(Config.szHostname), custom_hostname.getValue());
+      long lGroup = atol(custom_group.getValue());
+      Config.iGroup = lGroup >= 1 && lGroup <= 255 ? lGroup : DISPLAY_GROUP_DEFAULT;
+      if (!Store.Save(Config))
       {
-         Serial.println("failed to open config file for writing");
+         LOG_ERROR("failed to save config\r\n");
       }
-
-      json.prettyPrintTo(Serial);
-      json.printTo(configFile);
-      configFile.close();
-      //end save
    }
 
-   Serial.println("local ip");
-   Serial.println(WiFi.localIP());
-   Serial.println(WiFi.gatewayIP());
-   Serial.println(WiFi.subnetMask());
+   LOG_INFO("local ip\r\n%s\r\n%s\r\n%s\r\n", WiFi.localIP().toString().c_str(), WiFi.gatewayIP().toString().c_str(), WiFi.subnetMask().toString().c_str());
 }
 
+//Blinks the LED (active low) for ACTIVITY_LED_ON_TIME every ulLEDLinkInterval, each run schedules the next one
 void HandleActivityLED()
 {
-   if (millis() - ulLastLEDOnTime > (ulLEDLinkInterval + 100))
-   {
-      //LED should blink
-      ulLastLEDOnTime = millis();
-      ulLEDOnTime = millis();
-   }
-
-   if (millis() > ulLEDOnTime && millis() < (ulLEDOnTime + 100))
+   if (bLEDState == HIGH)
    {
-      bPrevledState = bLEDState;
       bLEDState = LOW;
+      Tasks.RunIn(iActivityLEDTask, ACTIVITY_LED_ON_TIME * 1000UL);
    }
    else
    {
-      bPrevledState = bLEDState;
       bLEDState = HIGH;
+      Tasks.RunIn(iActivityLEDTask, ulLEDLinkInterval * 1000UL);
    }
-
-   if (bLEDState != bPrevledState)
-   {
-      digitalWrite(ACTIVITY_LED_PIN, bLEDState);
-   }
+   digitalWrite(ACTIVITY_LED_PIN, bLEDState);
 }
 
 void HandleNWResetButton()
@@ -613,7 +1388,8 @@ void HandleNWResetButton()
 void ResetNetwork()
 {
    //We should clear wifi parameters
-   Serial.printf("Received a request to clear network, I will restart with autoconfig AP after this!\r\n");
+   LOG_INFO("Received a request to clear network, I will restart with autoconfig AP after this!\r\n");
+   Log.Flush();
    digitalWrite(ACTIVITY_LED_PIN, LOW);
    wifiMan.resetSettings();
    ESP.eraseConfig();
@@ -624,6 +1400,7 @@ void ResetNetwork()
 //callback notifying us of the need to save config
 void saveConfigCallback()
 {
-   Serial.println("Should save config");
+   LOG_INFO("Should save config\r\n");
    shouldSaveConfig = true;
-}
\ No newline at end of file
+}
+